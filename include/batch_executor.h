@@ -0,0 +1,133 @@
+/**
+ * @file batch_executor.h
+ * @brief Parallel execution of batched queries
+ *
+ * Most of the time spent on a batch is blocked in system calls
+ * (getprocs64, stat64, readlink, netstat), so queries are spread over a
+ * number of worker threads. Each worker owns a CollectorSet, so collector
+ * state is never shared between threads, and a deque of query indices.
+ * A worker takes work from the front of its own deque and, once that is
+ * empty, steals from the back of the other workers' deques, so one slow
+ * query (e.g. a stat on a hung NFS mount) only holds up its own worker.
+ *
+ * Results are handed back on the calling thread, either in input order or
+ * in the order they complete.
+ */
+
+#ifndef AIX_METADATA_BATCH_EXECUTOR_H
+#define AIX_METADATA_BATCH_EXECUTOR_H
+
+#include "types.h"
+#include "collector_set.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace AixMetadata {
+
+/**
+ * @brief Runs queries on a pool of workers with per-worker deques
+ */
+class BatchExecutor {
+public:
+    /**
+     * @brief Order in which results are handed back
+     */
+    enum class Order {
+        Input,       ///< Same order as the requests
+        Completion   ///< As soon as each query finishes
+    };
+
+    /**
+     * @brief Callback receiving each result on the calling thread
+     *
+     * The first argument is the index of the request in the batch; the
+     * result may be moved from.
+     */
+    typedef std::function<void(size_t, MetadataResult&)> ResultSink;
+
+    /**
+     * @brief Constructor
+     * @param collectors Collector set used by the first worker (and for
+     *        single-worker batches, on the calling thread)
+     * @param workers Number of workers; 0 selects one per CPU
+     * @param proto Protocol filter for the other workers' port collectors
+     *
+     * The other workers' collector sets copy the settings (timestamp
+     * format, limits, openers) of 'collectors', so configure it before
+     * constructing the executor.
+     */
+    BatchExecutor(CollectorSet& collectors, size_t workers,
+                  Protocol proto = Protocol::Both);
+
+    /**
+     * @brief Run every request and hand the results to a sink
+     *
+     * With one worker the requests run on the calling thread, in order.
+     *
+     * @param requests Queries to run
+     * @param order Order in which results reach the sink
+     * @param sink Receives each result on the calling thread
+     */
+    void run(const std::vector<QueryRequest>& requests, Order order,
+             const ResultSink& sink);
+
+    /**
+     * @brief Get the number of workers
+     */
+    size_t getWorkerCount() const { return m_workers.size(); }
+
+    /**
+     * @brief Get the collector set owned by a worker
+     * @param worker Worker index (0 is the set passed to the constructor)
+     */
+    CollectorSet& getCollectors(size_t worker) { return *m_workers[worker]->collectors; }
+
+    /**
+     * @brief Get the number of queries taken from another worker's deque
+     */
+    uint64_t getStealCount() const { return m_steals; }
+
+private:
+    /**
+     * @brief Per-worker state
+     */
+    struct Worker {
+        CollectorSet* collectors;                ///< Collectors used by this worker
+        std::unique_ptr<CollectorSet> owned;     ///< Set owned by workers other than the first
+        std::mutex mutex;                        ///< Guards tasks
+        std::deque<size_t> tasks;                ///< Indices of queued requests
+    };
+
+    /**
+     * @brief State shared by the workers of one run()
+     */
+    struct Batch;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;  ///< Worker 0 uses the caller's set
+    uint64_t m_steals;                                ///< Queries run by a thief
+
+    /**
+     * @brief Worker thread body: drain the own deque, then steal
+     * @param self Worker index
+     * @param batch Shared batch state
+     */
+    void work(size_t self, Batch& batch);
+
+    /**
+     * @brief Take the next query for a worker
+     * @param self Worker index
+     * @param index Output: request index
+     * @param stolen Output: whether it came from another worker's deque
+     * @return false if every deque is empty
+     */
+    bool take(size_t self, size_t& index, bool& stolen);
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_BATCH_EXECUTOR_H
@@ -19,6 +19,12 @@ namespace AixMetadata {
  *
  * All specific collectors (ProcessCollector, FileCollector, PortCollector)
  * inherit from this base class and implement the collect() method.
+ *
+ * A collector instance must only be used by one thread at a time (it keeps
+ * per-query caches and scratch state), but separate instances may collect
+ * concurrently: collectors only use reentrant system interfaces
+ * (localtime_r, strerror_r, getpwuid_r/getgrgid_r via IdentityCache) and
+ * share no other mutable state.
  */
 class CollectorBase {
 public:
@@ -0,0 +1,88 @@
+/**
+ * @file collector_set.h
+ * @brief One long-lived instance of every collector type
+ *
+ * Batch and daemon modes answer many queries per process. Keeping one
+ * collector of each type alive for all of them lets collector state
+ * (caches, socket table backends, indexes) be reused between queries
+ * instead of being rebuilt for every identifier.
+ */
+
+#ifndef AIX_METADATA_COLLECTOR_SET_H
+#define AIX_METADATA_COLLECTOR_SET_H
+
+#include "types.h"
+#include "process_collector.h"
+#include "file_collector.h"
+#include "port_collector.h"
+
+namespace AixMetadata {
+
+/**
+ * @brief Dispatches queries to a shared collector per query type
+ */
+class CollectorSet {
+public:
+    /**
+     * @brief Constructor
+     * @param proto Protocol filter for port queries
+     */
+    explicit CollectorSet(Protocol proto = Protocol::Both);
+
+    /**
+     * @brief Run a query through the matching collector
+     * @param request Query type and identifier
+     * @return MetadataResult from the collector
+     */
+    MetadataResult collect(const QueryRequest& request);
+
+    /**
+     * @brief Get the collector for a query type
+     * @param type Query type
+     * @return Collector handling that type
+     */
+    CollectorBase& get(QueryType type);
+
+    /**
+     * @brief Set how the process and file collectors render timestamps
+     * @param precision Seconds or nanoseconds
+     * @param offsetSuffix Whether to append the UTC offset
+     */
+    void setTimestampFormat(TimestampFormatter::Precision precision, bool offsetSuffix);
+
+    /**
+     * @brief Set the limit on the bytes of arguments reported per process
+     * @param bytes Limit (0: none)
+     */
+    void setCommandLineLimit(size_t bytes) { m_process.setCommandLineLimit(bytes); }
+
+    /**
+     * @brief Set the limit on the open files listed per process
+     * @param count Limit (0: none)
+     */
+    void setOpenFileLimit(size_t count) { m_process.setOpenFileLimit(count); }
+
+    /**
+     * @brief Set whether file results list the processes holding the file
+     */
+    void setFindOpeners(bool enabled) { m_file.setFindOpeners(enabled); }
+
+    /**
+     * @brief Copy the timestamp, limit and openers settings of another set
+     * @param other Set to copy from
+     */
+    void copySettings(CollectorSet& other);
+
+    ProcessCollector& process() { return m_process; }
+    FileCollector& file() { return m_file; }
+    PortCollector& port() { return m_port; }
+
+private:
+    ProcessCollector m_process;  ///< Shared process collector
+    FileCollector m_file;        ///< Shared file collector
+    PortCollector m_port;        ///< Shared port collector
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_COLLECTOR_SET_H
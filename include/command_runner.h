@@ -0,0 +1,63 @@
+/**
+ * @file command_runner.h
+ * @brief Runs helper programs (netstat, lsof) without a shell
+ *
+ * popen() starts /bin/sh, which then starts the program and any pipeline
+ * stages (grep, head). CommandRunner spawns the program directly with
+ * posix_spawnp(), reads its stdout into one growing buffer with large
+ * reads, and kills it if it does not finish within the timeout. Output
+ * filtering is left to the caller, in-process.
+ */
+
+#ifndef AIX_METADATA_COMMAND_RUNNER_H
+#define AIX_METADATA_COMMAND_RUNNER_H
+
+#include <string>
+#include <vector>
+
+namespace AixMetadata {
+
+/**
+ * @brief Spawns a program and captures its standard output
+ *
+ * stdin and stderr of the child are redirected to /dev/null.
+ */
+class CommandRunner {
+public:
+    /**
+     * @brief Constructor
+     * @param timeoutMs Maximum run time of a command in milliseconds
+     */
+    explicit CommandRunner(int timeoutMs = 10000);
+
+    /**
+     * @brief Set the maximum run time of a command
+     * @param timeoutMs Timeout in milliseconds
+     */
+    void setTimeout(int timeoutMs) { m_timeoutMs = timeoutMs; }
+
+    /**
+     * @brief Run a program and capture its stdout
+     *
+     * @param argv Program name (looked up in PATH) followed by its arguments
+     * @param output Output: everything the program wrote to stdout
+     * @param exitStatus Output (optional): exit code, or -1 if the program
+     *        was killed or did not exit normally
+     * @return false if the program could not be started or timed out
+     */
+    bool run(const std::vector<std::string>& argv, std::string& output,
+             int* exitStatus = nullptr);
+
+    /**
+     * @brief Get the reason the last run() returned false
+     */
+    const std::string& getLastError() const { return m_lastError; }
+
+private:
+    int m_timeoutMs;           ///< Per-command timeout
+    std::string m_lastError;   ///< Reason for the last failure
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_COMMAND_RUNNER_H
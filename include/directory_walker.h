@@ -0,0 +1,270 @@
+/**
+ * @file directory_walker.h
+ * @brief Parallel recursive file metadata walker
+ *
+ * DirectoryWalker inventories a directory tree, producing one
+ * FileCollector result per entry. Each directory is a task: the worker
+ * that takes it reads the entries in large getdents64() batches (readdir()
+ * outside Linux), stats them relative to the directory's fd in IoEngine
+ * batches and queues its subdirectories as new tasks, which are opened
+ * with openat() relative to the parent's fd. No entry costs a walk of its
+ * full path.
+ *
+ * Every worker owns a deque of directory tasks. It works depth-first
+ * from the back of its own deque, which keeps few directories open, and
+ * once that is empty steals the oldest task from the front of another
+ * worker's deque, which tends to be the largest unexplored subtree.
+ *
+ * Entries are not followed through symlinks. Filters (type, permission
+ * bits) only select what is reported; every directory within the depth
+ * limit is still descended.
+ */
+
+#ifndef AIX_METADATA_DIRECTORY_WALKER_H
+#define AIX_METADATA_DIRECTORY_WALKER_H
+
+#include "types.h"
+#include "file_collector.h"
+#include "file_stat.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace AixMetadata {
+
+/**
+ * @brief What a walk descends into and reports
+ */
+struct WalkOptions {
+    /**
+     * @brief Entry types, for typeMask
+     */
+    enum Type {
+        Regular = 1 << 0,
+        Directory = 1 << 1,
+        Symlink = 1 << 2,
+        BlockDevice = 1 << 3,
+        CharacterDevice = 1 << 4,
+        Fifo = 1 << 5,
+        Socket = 1 << 6
+    };
+
+    /**
+     * @brief Permission properties, for permissionMask
+     */
+    enum Permission {
+        Setuid = 1 << 0,
+        Setgid = 1 << 1,
+        Sticky = 1 << 2,
+        WorldWritable = 1 << 3   ///< Writable by others (symlinks excluded)
+    };
+
+    int maxDepth;               ///< Deepest level reported (root is 0); -1 for no limit
+    bool sameFilesystem;        ///< Do not descend into other filesystems
+    unsigned typeMask;          ///< Type bits to report; 0 reports every type
+    unsigned permissionMask;    ///< Report entries with any of these; 0 for no filter
+
+    WalkOptions() : maxDepth(-1), sameFilesystem(false), typeMask(0), permissionMask(0) {}
+
+    /**
+     * @brief Parse a type filter such as "f,d,l"
+     *
+     * Letters as in find -type: f, d, l, b, c, p, s.
+     *
+     * @param spec Comma-separated type letters
+     * @param mask Output: Type bits
+     * @param errorMessage Output: description of an invalid element
+     * @return false if the filter is invalid
+     */
+    static bool parseTypes(const std::string& spec, unsigned& mask, std::string& errorMessage);
+
+    /**
+     * @brief Parse a permission filter such as "setuid,world-writable"
+     *
+     * Names: setuid, setgid, sticky, world-writable.
+     *
+     * @param spec Comma-separated permission names
+     * @param mask Output: Permission bits
+     * @param errorMessage Output: description of an invalid element
+     * @return false if the filter is invalid
+     */
+    static bool parsePermissions(const std::string& spec, unsigned& mask,
+                                 std::string& errorMessage);
+};
+
+/**
+ * @brief Walks directory trees on a pool of work-stealing workers
+ */
+class DirectoryWalker {
+public:
+    /**
+     * @brief Callback receiving each result
+     *
+     * With more than one worker it is called concurrently from the worker
+     * threads; the first argument is the calling worker's index, so a sink
+     * can keep per-worker state without locking. The result may be moved
+     * from.
+     */
+    typedef std::function<void(size_t, MetadataResult&)> EntrySink;
+
+    /**
+     * @brief Constructor
+     * @param files File collector used by the first worker (and for
+     *        single-worker walks, on the calling thread); the other workers'
+     *        collectors copy its timestamp format
+     * @param workers Number of workers; 0 selects one per CPU
+     * @param options Depth, filesystem and filter options
+     */
+    DirectoryWalker(FileCollector& files, size_t workers, const WalkOptions& options);
+
+    ~DirectoryWalker();
+
+    /**
+     * @brief Walk a tree and hand every reported entry to a sink
+     *
+     * Entries that cannot be stat'ed and directories that cannot be read
+     * are reported as failed results.
+     *
+     * @param root Top of the tree (reported itself, not followed if a symlink)
+     * @param sink Receives each result
+     * @return false if the root itself cannot be stat'ed (reported to the sink)
+     */
+    bool run(const std::string& root, const EntrySink& sink);
+
+    /**
+     * @brief Get the number of workers
+     */
+    size_t getWorkerCount() const { return m_workers.size(); }
+
+    /**
+     * @brief Get the file collector of a worker
+     * @param worker Worker index (0 is the collector passed to the constructor)
+     */
+    FileCollector& getFiles(size_t worker) { return *m_workers[worker]->files; }
+
+    /**
+     * @brief Get the number of entries seen (reported or not)
+     */
+    uint64_t getEntryCount() const { return m_entries; }
+
+    /**
+     * @brief Get the number of entries reported
+     */
+    uint64_t getReportedCount() const { return m_reported; }
+
+    /**
+     * @brief Get the number of directories read
+     */
+    uint64_t getDirectoryCount() const { return m_directories; }
+
+    /**
+     * @brief Get the number of failed results reported
+     */
+    uint64_t getErrorCount() const { return m_errors; }
+
+    /**
+     * @brief Get the number of directory tasks taken from another worker
+     */
+    uint64_t getStealCount() const { return m_steals; }
+
+private:
+    /**
+     * @brief An open directory whose subdirectories are still queued
+     */
+    struct DirectoryHandle;
+
+    /**
+     * @brief A directory to read
+     */
+    struct Task {
+        std::shared_ptr<DirectoryHandle> parent;  ///< Parent to open 'name' in; null: use 'path'
+        std::string name;                         ///< Name within the parent
+        std::string path;                         ///< Full path
+        int depth;                                ///< Depth of the directory (root is 0)
+    };
+
+    /**
+     * @brief Per-worker state
+     */
+    struct Worker {
+        FileCollector* files;                    ///< Collector used by this worker
+        std::unique_ptr<FileCollector> owned;    ///< Collector owned by workers other than the first
+        std::mutex mutex;                        ///< Guards tasks
+        std::deque<Task> tasks;                  ///< Directories to read
+        std::vector<char> buffer;                ///< getdents64() buffer
+        std::string names;                       ///< NUL-separated names of one directory
+        std::vector<std::pair<size_t, unsigned>> entries;  ///< Offset in names, Type (0: unknown)
+        std::vector<FileStat> stats;             ///< Status of one batch of entries
+        std::vector<int> statResults;            ///< IoEngine results for stats
+        uint64_t entryCount;                     ///< Entries seen
+        uint64_t reportedCount;                  ///< Entries reported
+        uint64_t directoryCount;                 ///< Directories read
+        uint64_t errorCount;                     ///< Failed results
+        uint64_t stealCount;                     ///< Tasks stolen
+    };
+
+    WalkOptions m_options;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    const EntrySink* m_sink;             ///< Sink of the current run()
+    uint64_t m_rootDevice;               ///< Device of the root, for sameFilesystem
+
+    std::atomic<size_t> m_pending;       ///< Tasks queued or being read
+    std::atomic<size_t> m_queued;        ///< Tasks sitting in a deque
+    std::atomic<size_t> m_openHandles;   ///< Parent directories held open
+    std::mutex m_idleMutex;              ///< Guards waits on m_idle
+    std::condition_variable m_idle;      ///< Signalled on new tasks and when done
+
+    uint64_t m_entries;
+    uint64_t m_reported;
+    uint64_t m_directories;
+    uint64_t m_errors;
+    uint64_t m_steals;
+
+    /**
+     * @brief Worker thread body: read directories until the walk is done
+     * @param self Worker index
+     */
+    void work(size_t self);
+
+    /**
+     * @brief Take the next directory for a worker
+     * @param self Worker index
+     * @param task Output: the directory
+     * @return false if every deque is empty
+     */
+    bool take(size_t self, Task& task);
+
+    /**
+     * @brief Read one directory, report its entries and queue its subdirectories
+     * @param self Worker index
+     * @param task Directory to read
+     */
+    void readDirectory(size_t self, Task& task);
+
+    /**
+     * @brief Read all entry names of an open directory into the worker's buffers
+     * @return false with errno set on failure
+     */
+    bool listDirectory(int fd, Worker& worker);
+
+    /**
+     * @brief Whether an entry passes the type and permission filters
+     */
+    bool selected(const FileStat& st) const;
+
+    /**
+     * @brief Hand a failed result to the sink
+     */
+    void reportError(size_t self, const std::string& path, const std::string& what, int err);
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_DIRECTORY_WALKER_H
@@ -4,9 +4,11 @@
  *
  * This collector retrieves comprehensive metadata for a file given its path.
  * It uses standard POSIX APIs that work on AIX:
- *   - stat64() for file attributes
+ *   - statFile() for file attributes (statx() on Linux, stat64() on AIX)
+ *   - AccessChecker for the current user's permissions
  *   - readlink() for symbolic links
- *   - getpwuid()/getgrgid() for owner/group name resolution
+ *   - IdentityCache for owner/group name resolution
+ *   - OpenerScanner for the processes holding the file open (optional)
  *   - AIX-specific extended attributes if available
  */
 
@@ -14,8 +16,11 @@
 #define AIX_METADATA_FILE_COLLECTOR_H
 
 #include "collector_base.h"
+#include "timestamp_formatter.h"
+#include "file_stat.h"
+#include "io_engine.h"
+#include "opener_scanner.h"
 #include <sys/types.h>
-#include <sys/stat.h>
 
 namespace AixMetadata {
 
@@ -28,16 +33,17 @@ namespace AixMetadata {
  *   - Permissions (mode) in octal and symbolic notation
  *   - Owner UID and username
  *   - Group GID and group name
- *   - Access time, modification time, change time
+ *   - Access time, modification time, change time, birth time (Linux)
  *   - Inode number
- *   - Device ID
+ *   - Device ID and mount ID (Linux)
  *   - Number of hard links
  *   - Symlink target (if applicable)
  *   - Whether file is readable/writable/executable by current user
+ *   - With setFindOpeners(): every process and descriptor holding it open
  */
 class FileCollector : public CollectorBase {
 public:
-    FileCollector() = default;
+    FileCollector() : m_findOpeners(false) {}
     ~FileCollector() override = default;
 
     /**
@@ -48,41 +54,106 @@ public:
      */
     MetadataResult collect(const std::string& identifier) override;
 
+    /**
+     * @brief Collect metadata for an entry whose status is already known
+     *
+     * Used by the directory walker, which has stat'ed the entry relative
+     * to its directory; only symlink targets and access are looked up.
+     *
+     * @param dirfd Directory holding the entry (AT_FDCWD for the cwd)
+     * @param name Entry name, or path, relative to dirfd
+     * @param path Full path, reported as the identifier
+     * @param linkStat Status of the entry itself (symlinks not followed)
+     * @return MetadataResult containing all file metadata
+     */
+    MetadataResult collectEntry(int dirfd, const char* name, const std::string& path,
+                                const FileStat& linkStat);
+
     QueryType getType() const override { return QueryType::File; }
     std::string getName() const override { return "FileCollector"; }
 
+    /**
+     * @brief Formatter used for access/modify/change times
+     */
+    TimestampFormatter& timestamps() { return m_timestamps; }
+
+    /**
+     * @brief Checker behind the current_user_* attributes
+     */
+    const AccessChecker& accessChecker() const { return m_access; }
+
+    /**
+     * @brief Engine for bulk stats (e.g. of a whole directory)
+     */
+    IoEngine& io() { return m_io; }
+
+    /**
+     * @brief Report the processes holding each file open (default: off)
+     *
+     * Every file collected then costs a scan of all processes' fd tables.
+     */
+    void setFindOpeners(bool enabled) { m_findOpeners = enabled; }
+
+    /**
+     * @brief Whether the processes holding each file open are reported
+     */
+    bool getFindOpeners() const { return m_findOpeners; }
+
+    /**
+     * @brief Scanner behind the openers attribute
+     */
+    const OpenerScanner& openerScanner() const { return m_openers; }
+
 private:
+    TimestampFormatter m_timestamps;  ///< Renders the *_time attributes
+    AccessChecker m_access;           ///< Current user's permissions
+    IoEngine m_io;                    ///< Batched stats for bulk callers
+    bool m_findOpeners;               ///< Whether to report openers
+    OpenerScanner m_openers;          ///< Finds the processes holding a file
+
     /**
-     * @brief Collect basic file stats using stat64()
-     * @param path File path
+     * @brief Report the stats of an entry, following a symlink with statFile()
+     * @param dirfd Directory holding the entry
+     * @param name Entry name relative to dirfd
+     * @param linkStat Status of the entry itself
      * @param result Output: MetadataResult to populate
-     * @return true if successful
+     * @param target Output: status of the file, or of a symlink's target;
+     *        left zeroed for a broken symlink
      */
-    bool collectStats(const std::string& path, MetadataResult& result);
+    void collectStats(int dirfd, const char* name, const FileStat& linkStat,
+                      MetadataResult& result, FileStat& target);
 
     /**
      * @brief Collect symlink information if applicable
-     * @param path File path
-     * @param statBuf Stat buffer with file info
+     * @param dirfd Directory holding the symlink
+     * @param name Symlink name relative to dirfd
      * @param result Output: MetadataResult to populate
      */
-    void collectSymlinkInfo(const std::string& path,
-                            const struct stat64& statBuf,
-                            MetadataResult& result);
+    void collectSymlinkInfo(int dirfd, const char* name, MetadataResult& result);
 
     /**
      * @brief Collect owner and group information
-     * @param statBuf Stat buffer with file info
+     * @param st File status
      * @param result Output: MetadataResult to populate
      */
-    void collectOwnership(const struct stat64& statBuf, MetadataResult& result);
+    void collectOwnership(const FileStat& st, MetadataResult& result);
 
     /**
      * @brief Collect access permissions for current user
-     * @param path File path
+     * @param dirfd Directory holding the entry
+     * @param name Entry name relative to dirfd
+     * @param target Status of the file (mode 0 for a broken symlink)
+     * @param result Output: MetadataResult to populate
+     */
+    void collectAccessInfo(int dirfd, const char* name, const FileStat& target,
+                           MetadataResult& result);
+
+    /**
+     * @brief Collect the processes holding a file open
+     * @param target Status of the file
      * @param result Output: MetadataResult to populate
      */
-    void collectAccessInfo(const std::string& path, MetadataResult& result);
+    void collectOpeners(const FileStat& target, MetadataResult& result);
 
     /**
      * @brief Convert file type from mode to string
@@ -99,11 +170,11 @@ private:
     std::string modeToSymbolic(mode_t mode);
 
     /**
-     * @brief Convert time value to ISO 8601 string
-     * @param timeVal Time value (seconds since epoch)
+     * @brief Convert a file time to ISO 8601 string
+     * @param time File time
      * @return ISO 8601 formatted string
      */
-    std::string timeToString(time_t timeVal);
+    std::string timeToString(const FileTime& time);
 };
 
 } // namespace AixMetadata
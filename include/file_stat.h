@@ -0,0 +1,193 @@
+/**
+ * @file file_stat.h
+ * @brief Single-call file status and userspace access checks
+ *
+ * statFile() fills a FileStat with everything the file collector reports:
+ *   - Linux: one statx() call for exactly those fields, which also returns
+ *     the birth time and mount ID where the kernel and filesystem have them
+ *   - Elsewhere (AIX), or if statx() is blocked: a large-file fstatat()
+ *
+ * AccessChecker answers "may the current user read/write/execute this
+ * file" without three access() path walks. On Linux it evaluates the
+ * owner/group/other bits, the supplementary groups and the
+ * CAP_DAC_OVERRIDE/CAP_DAC_READ_SEARCH capabilities against the FileStat,
+ * and applies the read-only, noexec and immutable rules faccessat() would.
+ * It falls back to faccessat(AT_EACCESS) for any answer it cannot be sure
+ * of: files with a POSIX ACL, network and FUSE filesystems (the server
+ * decides), and files whose owner is not mapped into our user namespace.
+ * Other platforms always use faccessat().
+ *
+ * Answers reflect discretionary access control; an LSM such as SELinux
+ * may still deny an access the userspace check grants.
+ */
+
+#ifndef AIX_METADATA_FILE_STAT_H
+#define AIX_METADATA_FILE_STAT_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+#ifdef __linux__
+struct statx;
+#endif
+
+namespace AixMetadata {
+
+/**
+ * @brief A file timestamp
+ */
+struct FileTime {
+    int64_t seconds;        ///< Seconds since the Epoch
+    uint32_t nanoseconds;   ///< Nanoseconds within the second
+
+    FileTime() : seconds(0), nanoseconds(0) {}
+};
+
+/**
+ * @brief Status of a file, independent of the call that produced it
+ */
+struct FileStat {
+    mode_t mode;              ///< Type and permission bits
+    uint64_t device;          ///< Device ID (st_dev encoding)
+    uint64_t inode;           ///< Inode number
+    uint64_t nlink;           ///< Number of hard links
+    uid_t uid;                ///< Owner user ID
+    gid_t gid;                ///< Owner group ID
+    uint64_t size;            ///< Size in bytes
+    int64_t blockSize;        ///< Preferred I/O block size
+    int64_t blocks;           ///< Number of 512-byte blocks
+    uint32_t rdevMajor;       ///< Device major number (device files)
+    uint32_t rdevMinor;       ///< Device minor number (device files)
+    FileTime accessTime;      ///< Last access
+    FileTime modifyTime;      ///< Last modification
+    FileTime changeTime;      ///< Last status change
+    FileTime birthTime;       ///< Creation (valid if hasBirthTime)
+    uint64_t mountId;         ///< Mount ID (valid if hasMountId)
+    bool hasBirthTime;        ///< Whether the filesystem reported a birth time
+    bool hasMountId;          ///< Whether the kernel reported a mount ID
+    bool immutableKnown;      ///< Whether 'immutable' is reported by the filesystem
+    bool immutable;           ///< Immutable attribute (writes denied, even to root)
+
+    FileStat()
+        : mode(0), device(0), inode(0), nlink(0), uid(0), gid(0), size(0),
+          blockSize(0), blocks(0), rdevMajor(0), rdevMinor(0), mountId(0),
+          hasBirthTime(false), hasMountId(false), immutableKnown(false),
+          immutable(false) {}
+};
+
+/**
+ * @brief Get the status of a file in one call
+ * @param dirfd Directory for relative paths (AT_FDCWD for the cwd)
+ * @param path File path
+ * @param followLinks Report on the target of a symlink rather than the link
+ * @param st Output: file status
+ * @return false with errno set on failure
+ */
+bool statFile(int dirfd, const char* path, bool followLinks, FileStat& st);
+
+#ifdef __linux__
+/**
+ * @brief Get the statx() mask statFile() requests
+ *
+ * For callers that issue the statx() themselves (see IoEngine).
+ */
+unsigned statxFileMask();
+
+/**
+ * @brief Fill a FileStat from a statx() made with statxFileMask()
+ * @param buf statx() answer
+ * @param st Output: file status
+ */
+void fileStatFromStatx(const struct statx& buf, FileStat& st);
+#endif
+
+/**
+ * @brief Current user's access to a file
+ */
+struct FileAccess {
+    bool readable;
+    bool writable;
+    bool executable;
+
+    FileAccess() : readable(false), writable(false), executable(false) {}
+};
+
+/**
+ * @brief Answers access questions from a FileStat where possible
+ *
+ * Credentials are read once, on first use. Mount flags are cached per
+ * mount ID for a minute. Not thread-safe; use one checker per thread.
+ */
+class AccessChecker {
+public:
+    AccessChecker();
+
+    /**
+     * @brief Work out the current user's access to a file
+     * @param dirfd Directory for relative paths (AT_FDCWD for the cwd)
+     * @param path File path (symlinks are followed)
+     * @param st Status of the file, with symlinks followed
+     * @return Access for the effective user and groups
+     */
+    FileAccess check(int dirfd, const char* path, const FileStat& st);
+
+    /**
+     * @brief Get the number of files checked
+     */
+    uint64_t getCheckCount() const { return m_checks; }
+
+    /**
+     * @brief Get the number of faccessat() calls made
+     */
+    uint64_t getKernelCheckCount() const { return m_kernelChecks; }
+
+private:
+    /**
+     * @brief Cached flags of one mount
+     */
+    struct MountFlags {
+        bool readOnly;      ///< Mounted read-only
+        bool noExec;        ///< Mounted noexec
+        bool delegated;     ///< Permissions are decided elsewhere (NFS, FUSE, ...)
+        int64_t expires;    ///< Monotonic time after which to re-read
+    };
+
+    bool m_loaded;                   ///< Whether the fields below are set
+    bool m_userspace;                ///< Credentials could be read
+    uid_t m_euid;                    ///< Effective user ID
+    gid_t m_egid;                    ///< Effective group ID
+    std::vector<gid_t> m_groups;     ///< Supplementary groups
+    bool m_dacOverride;              ///< Holds CAP_DAC_OVERRIDE
+    bool m_dacReadSearch;            ///< Holds CAP_DAC_READ_SEARCH
+    bool m_allIdsMapped;             ///< In the initial user namespace
+    std::unordered_map<uint64_t, MountFlags> m_mounts;  ///< Keyed by mount ID
+    uint64_t m_checks;               ///< Files checked
+    uint64_t m_kernelChecks;         ///< faccessat() calls
+
+    /**
+     * @brief Read the effective credentials and capabilities
+     */
+    void loadCredentials();
+
+    /**
+     * @brief Whether a group is the effective or a supplementary group
+     */
+    bool inGroup(gid_t gid) const;
+
+    /**
+     * @brief Get the flags of the mount a file is on
+     * @return false if they cannot be determined
+     */
+    bool lookupMount(int dirfd, const char* path, const FileStat& st, MountFlags& flags);
+
+    /**
+     * @brief Ask the kernel about one access mode
+     */
+    bool kernelCheck(int dirfd, const char* path, int mode);
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_FILE_STAT_H
@@ -0,0 +1,121 @@
+/**
+ * @file identity_cache.h
+ * @brief Shared UID/GID to name resolution cache
+ *
+ * getpwuid()/getgrgid() may go to LDAP or NIS and cost a network round
+ * trip per call, and they return pointers to static storage. All
+ * collectors resolve user and group names through this cache instead,
+ * which uses the reentrant getpwuid_r()/getgrgid_r() underneath.
+ *
+ * Entries expire after a TTL. Lookups that find no such user/group are
+ * cached too (negative caching), with a shorter TTL of their own.
+ * Resolver errors are not cached.
+ */
+
+#ifndef AIX_METADATA_IDENTITY_CACHE_H
+#define AIX_METADATA_IDENTITY_CACHE_H
+
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace AixMetadata {
+
+/**
+ * @brief Hit/miss counters for the identity cache
+ */
+struct IdentityCacheStats {
+    uint64_t hits;          ///< Lookups answered from a cached name
+    uint64_t negativeHits;  ///< Lookups answered from a cached "not found"
+    uint64_t misses;        ///< Lookups that went to the resolver
+    size_t users;           ///< Cached user entries
+    size_t groups;          ///< Cached group entries
+
+    IdentityCacheStats() : hits(0), negativeHits(0), misses(0), users(0), groups(0) {}
+};
+
+/**
+ * @brief Thread-safe, process-wide user and group name cache
+ */
+class IdentityCache {
+public:
+    /**
+     * @brief Get the process-wide cache instance
+     */
+    static IdentityCache& instance();
+
+    /**
+     * @brief Resolve a UID to a user name
+     * @param uid User ID
+     * @param name Output: user name
+     * @param primaryGid Output (optional): the user's primary GID
+     * @return false if the user does not exist or cannot be resolved
+     */
+    bool lookupUser(uid_t uid, std::string& name, gid_t* primaryGid = nullptr);
+
+    /**
+     * @brief Resolve a GID to a group name
+     * @param gid Group ID
+     * @param name Output: group name
+     * @return false if the group does not exist or cannot be resolved
+     */
+    bool lookupGroup(gid_t gid, std::string& name);
+
+    /**
+     * @brief Set entry lifetimes
+     * @param positiveSeconds Lifetime of resolved names
+     * @param negativeSeconds Lifetime of "not found" answers
+     */
+    void setTtl(int positiveSeconds, int negativeSeconds);
+
+    /**
+     * @brief Drop all cached entries (statistics are kept)
+     */
+    void clear();
+
+    /**
+     * @brief Get a snapshot of the cache statistics
+     */
+    IdentityCacheStats getStats() const;
+
+private:
+    /**
+     * @brief Cached resolver answer
+     */
+    struct Entry {
+        bool found;         ///< Whether the ID exists
+        std::string name;   ///< Resolved name (if found)
+        gid_t primaryGid;   ///< Primary GID (user entries only)
+        int64_t expires;    ///< Monotonic expiry time in seconds
+    };
+
+    IdentityCache();
+    IdentityCache(const IdentityCache&) = delete;
+    IdentityCache& operator=(const IdentityCache&) = delete;
+
+    mutable std::mutex m_mutex;                  ///< Guards all members below
+    std::unordered_map<uid_t, Entry> m_users;    ///< UID -> entry
+    std::unordered_map<gid_t, Entry> m_groups;   ///< GID -> entry
+    int m_positiveTtl;                           ///< Seconds
+    int m_negativeTtl;                           ///< Seconds
+    IdentityCacheStats m_stats;                  ///< Counters
+
+    /**
+     * @brief Check a cache map; counts the hit if the entry is valid
+     * @return true if a valid entry was found and copied to 'entry'
+     */
+    template <typename Map, typename Key>
+    bool findValid(Map& map, Key key, Entry& entry);
+
+    /**
+     * @brief Store a resolver answer
+     */
+    template <typename Map, typename Key>
+    void store(Map& map, Key key, Entry& entry);
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_IDENTITY_CACHE_H
@@ -0,0 +1,177 @@
+/**
+ * @file io_engine.h
+ * @brief Batched file system calls for bulk collection
+ *
+ * Bulk modes (directory walks, whole process table snapshots) issue the
+ * same few calls - stat, open, read, close - for thousands of files. An
+ * IoEngine queues them and runs a whole batch at once:
+ *   - Linux: through an io_uring, so a batch of up to getDepth()
+ *     operations costs one io_uring_enter() instead of one system call
+ *     each. The kernel runs stat, open and /proc reads on its io-wq
+ *     worker threads, so a batch proceeds in parallel on several CPUs
+ *   - Elsewhere, where io_uring is unavailable (old kernel, disabled by
+ *     sysctl, blocked by a seccomp profile) or on a single CPU, where the
+ *     hand-off to io-wq costs more than the calls it saves: each call is
+ *     made directly when it is queued
+ *
+ * Results use the io_uring convention: the call's return value, or a
+ * negative errno value on failure.
+ *
+ * There is no io_uring operation for readlink(), so symlink targets are
+ * still read with plain calls.
+ */
+
+#ifndef AIX_METADATA_IO_ENGINE_H
+#define AIX_METADATA_IO_ENGINE_H
+
+#include "file_stat.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace AixMetadata {
+
+/**
+ * @brief Queue of file system calls run in batches
+ *
+ * Results are complete once submit() returns. Paths and buffers passed
+ * to the queueing calls must stay valid until then. If the queue fills
+ * up it is submitted automatically, so results of earlier operations may
+ * be ready sooner. Not thread-safe; use one engine per thread.
+ */
+class IoEngine {
+public:
+    /**
+     * @brief Default number of operations per batch
+     */
+    static const unsigned DEFAULT_DEPTH = 256;
+
+    /**
+     * @brief When engines use io_uring
+     */
+    enum class Mode {
+        Auto,      ///< If available and more than one CPU is online
+        IoUring,   ///< If available
+        Direct     ///< Never; every call is made directly
+    };
+
+    /**
+     * @brief Set the mode of engines not used yet (default: Auto)
+     */
+    static void setMode(Mode mode);
+
+    /**
+     * @brief Constructor; the io_uring is set up on first use
+     * @param depth Operations per batch
+     */
+    explicit IoEngine(unsigned depth = DEFAULT_DEPTH);
+
+    ~IoEngine();
+
+    /**
+     * @brief Whether batches run through io_uring
+     *
+     * Sets up the io_uring if that has not been tried yet.
+     */
+    bool isAsync();
+
+    /**
+     * @brief Get the number of operations per batch
+     */
+    unsigned getDepth() const { return m_depth; }
+
+    /**
+     * @brief Queue a statFile()
+     * @param dirfd Directory for relative paths (AT_FDCWD for the cwd)
+     * @param path File path
+     * @param followLinks Report on the target of a symlink
+     * @param st Output: file status
+     * @param result Output: 0, or a negative errno value
+     */
+    void stat(int dirfd, const char* path, bool followLinks, FileStat& st, int& result);
+
+    /**
+     * @brief Queue an openat()
+     * @param dirfd Directory for relative paths (AT_FDCWD for the cwd)
+     * @param path File path
+     * @param flags Open flags (O_CLOEXEC is added)
+     * @param result Output: the descriptor, or a negative errno value
+     */
+    void open(int dirfd, const char* path, int flags, int& result);
+
+    /**
+     * @brief Queue a pread()
+     * @param fd Descriptor; may be the result of an open() queued earlier
+     *        only once that has completed
+     * @param buffer Output: data read
+     * @param length Bytes to read at most
+     * @param offset File offset
+     * @param result Output: bytes read, or a negative errno value
+     */
+    void read(int fd, void* buffer, size_t length, uint64_t offset, int& result);
+
+    /**
+     * @brief Queue a close()
+     * @param fd Descriptor
+     */
+    void close(int fd);
+
+    /**
+     * @brief Run every queued operation and wait for all of them
+     */
+    void submit();
+
+    /**
+     * @brief Get the number of operations run
+     */
+    uint64_t getOperationCount() const { return m_operations; }
+
+    /**
+     * @brief Get the number of batches handed to io_uring
+     */
+    uint64_t getSubmitCount() const { return m_submits; }
+
+private:
+    /**
+     * @brief The mapped io_uring
+     */
+    struct Ring;
+
+    /**
+     * @brief One queued operation
+     */
+    struct Operation {
+        enum Kind { Stat, Open, Read, Close } kind;
+        int fd;               ///< Directory or file descriptor
+        const char* path;     ///< Stat, Open
+        int flags;            ///< Open flags; Stat: followLinks
+        void* buffer;         ///< Read
+        size_t length;        ///< Read
+        uint64_t offset;      ///< Read
+        FileStat* st;         ///< Stat
+        int* result;          ///< Where to store the result (null for Close)
+    };
+
+    unsigned m_depth;
+    bool m_tried;                        ///< Whether setting up the ring was tried
+    std::unique_ptr<Ring> m_ring;        ///< Null: run calls directly
+    std::vector<Operation> m_queue;      ///< Operations not yet submitted
+    uint64_t m_operations;
+    uint64_t m_submits;
+
+    /**
+     * @brief Queue an operation, or run it directly without a ring
+     */
+    void enqueue(const Operation& op);
+
+    /**
+     * @brief Run an operation with a plain system call
+     */
+    static void runDirect(const Operation& op);
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_IO_ENGINE_H
@@ -0,0 +1,50 @@
+/**
+ * @file json_escape.h
+ * @brief Fast scanning for characters that need JSON escaping
+ *
+ * Command lines, environments and open-file lists can be many KB per
+ * result, and almost none of it needs escaping. The scanner finds the
+ * next '"', '\\' or control character so clean runs can be copied in
+ * bulk. The implementation is picked once at startup:
+ *   - AVX2 (32 bytes per step) on x86 CPUs that support it
+ *   - SSE2 (16 bytes per step) on other x86-64 CPUs
+ *   - a portable 8-bytes-per-word scan everywhere else (including AIX)
+ */
+
+#ifndef AIX_METADATA_JSON_ESCAPE_H
+#define AIX_METADATA_JSON_ESCAPE_H
+
+#include <cstddef>
+
+namespace AixMetadata {
+
+/**
+ * @brief Find the first byte that must be escaped in a JSON string
+ * @param data Bytes to scan
+ * @param size Number of bytes
+ * @return Offset of the first '"', '\\' or byte < 0x20, or size if none
+ */
+size_t findJsonEscape(const char* data, size_t size);
+
+/**
+ * @brief Name of the scanner selected for this CPU ("avx2", "sse2", "swar")
+ */
+const char* jsonEscapeBackend();
+
+/**
+ * @brief Scan with a named implementation rather than the selected one
+ *
+ * For the differential fuzzer: "scalar" (byte at a time) is always
+ * available, "avx2" and "sse2" only where built and supported by the CPU.
+ *
+ * @param backend Implementation name ("scalar", "swar", "sse2", "avx2")
+ * @param data Bytes to scan
+ * @param size Number of bytes
+ * @param offset Output: as findJsonEscape()
+ * @return false if the implementation is unavailable here
+ */
+bool findJsonEscapeWith(const char* backend, const char* data, size_t size, size_t& offset);
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_JSON_ESCAPE_H
@@ -5,6 +5,9 @@
  * This file provides a simple JSON formatter that doesn't require
  * external JSON libraries. It converts MetadataResult objects to
  * JSON strings suitable for output or further processing.
+ *
+ * These helpers return a fresh string per call. Code that formats many
+ * results should append into a reused buffer with JsonWriter instead.
  */
 
 #ifndef AIX_METADATA_JSON_FORMATTER_H
@@ -12,7 +15,7 @@
 
 #include "types.h"
 #include <string>
-#include <sstream>
+#include <vector>
 
 namespace AixMetadata {
 
@@ -30,45 +33,23 @@ public:
      *
      * @param result The metadata result to format
      * @param prettyPrint Whether to format with indentation (default: true)
+     * @param stringValues Output every value as a string (compatibility mode)
      * @return JSON string representation
      */
-    static std::string format(const MetadataResult& result, bool prettyPrint = true);
+    static std::string format(const MetadataResult& result, bool prettyPrint = true,
+                              bool stringValues = false);
 
     /**
      * @brief Convert multiple MetadataResults to JSON array string
      *
      * @param results Vector of metadata results
      * @param prettyPrint Whether to format with indentation
+     * @param stringValues Output every value as a string (compatibility mode)
      * @return JSON array string representation
      */
     static std::string formatArray(const std::vector<MetadataResult>& results,
-                                   bool prettyPrint = true);
-
-private:
-    /**
-     * @brief Escape special characters in a string for JSON
-     * @param str Input string
-     * @return Escaped string safe for JSON
-     */
-    static std::string escapeString(const std::string& str);
-
-    /**
-     * @brief Get indentation string for pretty printing
-     * @param level Indentation level
-     * @return String of spaces for indentation
-     */
-    static std::string indent(int level);
-
-    /**
-     * @brief Format a single attribute as JSON
-     * @param attr The attribute to format
-     * @param prettyPrint Whether to format with indentation
-     * @param indentLevel Current indentation level
-     * @return JSON string for the attribute
-     */
-    static std::string formatAttribute(const MetadataAttribute& attr,
-                                       bool prettyPrint,
-                                       int indentLevel);
+                                   bool prettyPrint = true,
+                                   bool stringValues = false);
 };
 
 } // namespace AixMetadata
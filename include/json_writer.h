@@ -0,0 +1,159 @@
+/**
+ * @file json_writer.h
+ * @brief Streaming JSON writer for metadata results
+ *
+ * JsonWriter appends JSON text directly into a caller-owned output
+ * buffer. No intermediate streams or strings are built, so a caller that
+ * reuses one buffer (clearing it between results) formats results without
+ * any heap allocation once the buffer has grown to its working size.
+ *
+ * Numeric and boolean attributes are written as native JSON numbers and
+ * booleans, and list attributes always as arrays. In string-values mode
+ * every value is written as a JSON string instead, exactly as earlier
+ * versions did ("pid": "1234"); a single-element list then collapses to
+ * a string and an empty one to null, and a packed list (a command line)
+ * is joined with spaces into one string. Nested objects and arrays of
+ * objects keep their structure in both modes.
+ */
+
+#ifndef AIX_METADATA_JSON_WRITER_H
+#define AIX_METADATA_JSON_WRITER_H
+
+#include "types.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace AixMetadata {
+
+/**
+ * @brief Appends MetadataResult JSON to an output buffer
+ */
+class JsonWriter {
+public:
+    /**
+     * @brief Constructor
+     * @param out Buffer the JSON text is appended to (not cleared)
+     * @param prettyPrint Whether to format with indentation
+     * @param stringValues Write all values as strings (compatibility mode)
+     */
+    JsonWriter(std::string& out, bool prettyPrint, bool stringValues = false);
+
+    /**
+     * @brief Append one result as a JSON object
+     * @param result The metadata result to write
+     */
+    void writeResult(const MetadataResult& result);
+
+    /**
+     * @brief Append results as a JSON array of objects
+     * @param results Metadata results to write
+     */
+    void writeArray(const std::vector<MetadataResult>& results);
+
+    /**
+     * @brief Append a string with JSON escaping (without quotes)
+     * @param out Output buffer
+     * @param str Raw string
+     */
+    static void appendEscaped(std::string& out, const std::string& str);
+
+    /**
+     * @brief Append characters with JSON escaping (without quotes)
+     * @param out Output buffer
+     * @param data Raw characters
+     * @param size Number of characters
+     */
+    static void appendEscaped(std::string& out, const char* data, size_t size);
+
+    /**
+     * @brief Append the decimal digits of an unsigned integer
+     * @param out Output buffer
+     * @param value Value to format
+     */
+    static void appendInteger(std::string& out, uint64_t value);
+
+    /**
+     * @brief Append the decimal digits of a signed integer
+     * @param out Output buffer
+     * @param value Value to format
+     */
+    static void appendInteger(std::string& out, int64_t value);
+
+private:
+    std::string& m_out;     ///< Output buffer
+    bool m_pretty;          ///< Pretty-print mode
+    bool m_stringValues;    ///< Quote every value (compatibility mode)
+    int m_baseIndent;       ///< Indent level applied to every line
+
+    /**
+     * @brief Start a new line (pretty mode only)
+     *
+     * Writes the newline and the base indentation of the enclosing
+     * container, but not the line's own indentation.
+     */
+    void newline();
+
+    /**
+     * @brief Append indentation for a nesting level (pretty mode only)
+     * @param level Indentation level
+     */
+    void indent(int level);
+
+    /**
+     * @brief Append "name": for a fixed field name that needs no escaping
+     * @param name Key name
+     */
+    void key(const char* name);
+
+    /**
+     * @brief Append "name": with the separator space in pretty mode
+     * @param name Key name (escaped on output)
+     */
+    void key(const std::string& name);
+
+    /**
+     * @brief Append a quoted, escaped string value
+     * @param value Raw string
+     */
+    void stringValue(const std::string& value);
+
+    /**
+     * @brief Append a list of strings as a JSON array
+     * @param values List elements
+     */
+    void stringArray(const std::vector<std::string>& values);
+
+    /**
+     * @brief Append the elements of a PackedList
+     * @param packed Elements, each followed by a NUL
+     * @param joined Write one string with the elements separated by
+     *        spaces instead of an array
+     */
+    void packedList(const std::string& packed, bool joined);
+
+    /**
+     * @brief Append a nested object
+     * @param fields Object fields
+     * @param level Indentation level of the line holding the opening brace
+     */
+    void object(const std::vector<MetadataAttribute>& fields, int level);
+
+    /**
+     * @brief Append an array of nested objects
+     * @param elements Object attributes (their names are ignored)
+     * @param level Indentation level of the line holding the opening bracket
+     */
+    void objectArray(const std::vector<MetadataAttribute>& elements, int level);
+
+    /**
+     * @brief Append one attribute as a key/value pair
+     * @param attr The attribute to write
+     * @param level Indentation level of the attribute's line
+     */
+    void attribute(const MetadataAttribute& attr, int level);
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_JSON_WRITER_H
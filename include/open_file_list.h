@@ -0,0 +1,114 @@
+/**
+ * @file open_file_list.h
+ * @brief Open file descriptors of a process
+ *
+ * A process may hold tens of thousands of descriptors. OpenFileList opens
+ * /proc/<pid>/fd once and resolves each entry with readlinkat() relative
+ * to it, so no entry costs a path lookup from the root. Every
+ * "fd:target" string is appended to one NUL-packed buffer, ready to be
+ * handed to MetadataResult::addPackedList() without a copy, and only the
+ * first 'limit' descriptors are resolved; the rest are only counted.
+ *
+ * Entries are classified by their link target on Linux ("socket:[...]",
+ * "pipe:[...]", "anon_inode:..." or a path). AIX procfs entries are not
+ * symlinks, so there the type comes from fstatat() and the string is the
+ * descriptor number alone.
+ */
+
+#ifndef AIX_METADATA_OPEN_FILE_LIST_H
+#define AIX_METADATA_OPEN_FILE_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+namespace AixMetadata {
+
+/**
+ * @brief Lists the open file descriptors of one process at a time
+ *
+ * Not thread-safe; use one list per thread.
+ */
+class OpenFileList {
+public:
+    /**
+     * @brief Kinds of open files
+     */
+    enum Type {
+        File,       ///< Path in a filesystem (regular file, directory, device)
+        Socket,
+        Pipe,       ///< Pipe or FIFO
+        AnonInode,  ///< eventfd, epoll, timerfd, signalfd, ...
+        Other,      ///< Namespace or other pseudo file, or not resolvable
+        TYPE_COUNT
+    };
+
+    OpenFileList() : m_total(0), m_truncated(false) { clearCounts(); }
+
+    /**
+     * @brief Read a process's descriptor table, replacing the previous one
+     * @param pid Process ID
+     * @param limit Descriptors resolved at most (0: no limit)
+     * @return false if /proc/<pid>/fd cannot be opened (process gone,
+     *         permission denied)
+     */
+    bool read(pid_t pid, size_t limit);
+
+    /**
+     * @brief Get the "fd:target" strings, each followed by a NUL
+     *
+     * The caller may move the buffer away; the next read() refills it.
+     */
+    std::string& entries() { return m_entries; }
+
+    /**
+     * @brief Get the descriptor numbers whose link target may be cut short,
+     *        each followed by a NUL
+     *
+     * readlinkat() does not report truncation; a target that fills the
+     * PATH_MAX buffer is listed with the bytes that fit and recorded here.
+     * The caller may move the buffer away; the next read() refills it.
+     */
+    std::string& truncatedTargets() { return m_truncatedTargets; }
+
+    /**
+     * @brief Get the number of open descriptors, including unresolved ones
+     */
+    uint64_t getTotalCount() const { return m_total; }
+
+    /**
+     * @brief Whether descriptors beyond the limit were left unresolved
+     */
+    bool isTruncated() const { return m_truncated; }
+
+    /**
+     * @brief Get the number of resolved descriptors of a type
+     */
+    uint64_t getTypeCount(Type type) const { return m_typeCounts[type]; }
+
+    /**
+     * @brief Get the attribute name of a type ("file", "socket", ...)
+     */
+    static const char* typeName(Type type);
+
+    /**
+     * @brief Classify a descriptor by its /proc link target
+     * @param target Link target (not NUL-terminated)
+     * @param length Bytes in target
+     */
+    static Type classifyTarget(const char* target, size_t length);
+
+private:
+    std::string m_entries;                ///< Packed "fd:target" strings
+    std::string m_truncatedTargets;       ///< Packed fds with cut targets
+    uint64_t m_total;                     ///< Descriptors seen
+    bool m_truncated;                     ///< Whether the limit was reached
+    uint64_t m_typeCounts[TYPE_COUNT];    ///< Resolved descriptors per type
+
+    void clearCounts();
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_OPEN_FILE_LIST_H
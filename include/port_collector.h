@@ -10,36 +10,30 @@
  *   - getkerninfo() for socket table access
  *
  * For this PoC, we use netstat parsing as it's the most reliable
- * and portable approach on AIX 7.2.
+ * and portable approach on AIX 7.2. Where a native SocketTableReader is
+ * available (e.g. /proc/net on Linux) it is used instead, and netstat is
+ * only run if the native backend fails.
  */
 
 #ifndef AIX_METADATA_PORT_COLLECTOR_H
 #define AIX_METADATA_PORT_COLLECTOR_H
 
 #include "collector_base.h"
+#include "socket_table.h"
+#include "socket_owner_index.h"
+#include "command_runner.h"
+#include "port_set.h"
+#include <map>
+#include <memory>
 #include <vector>
 
 namespace AixMetadata {
 
-/**
- * @brief Information about a single network connection
- */
-struct ConnectionInfo {
-    std::string protocol;        ///< "tcp" or "udp"
-    std::string localAddress;    ///< Local IP address
-    std::string localPort;       ///< Local port number
-    std::string remoteAddress;   ///< Remote IP address (for TCP)
-    std::string remotePort;      ///< Remote port number (for TCP)
-    std::string state;           ///< Connection state (LISTEN, ESTABLISHED, etc.)
-    pid_t pid;                   ///< Process ID (if available)
-    std::string processName;     ///< Process name (if available)
-    std::string user;            ///< User owning the socket (if available)
-};
-
 /**
  * @brief Collects metadata for network ports on AIX
  *
- * Given a port number, this collector retrieves:
+ * Given a port number, a port specification ("22,80,8000-8100") or
+ * "listening", this collector retrieves:
  *   - All connections using that port (listening or connected)
  *   - Protocol (TCP/UDP)
  *   - Local and remote addresses
@@ -58,9 +52,21 @@ public:
     ~PortCollector() override = default;
 
     /**
-     * @brief Collect all available metadata for a port
+     * @brief Identifier selecting every listening socket
+     */
+    static const char* const LISTENING_IDENTIFIER;
+
+    /**
+     * @brief Collect all available metadata for a port or set of ports
      *
-     * @param identifier The port number as a string (e.g., "22", "80")
+     * A single port keeps the flat shape (port, num_connections,
+     * connections). A list or range, or LISTENING_IDENTIFIER, produces
+     * num_ports, num_connections and a "ports" array grouping the
+     * connections per port in ascending order; only ports with sockets
+     * are listed.
+     *
+     * @param identifier The port number as a string (e.g., "22", "80"),
+     *        a port specification (e.g., "22,80,8000-8100") or "listening"
      * @return MetadataResult containing all port/connection metadata
      */
     MetadataResult collect(const std::string& identifier) override;
@@ -74,62 +80,96 @@ public:
      */
     void setProtocol(Protocol proto) { m_protocol = proto; }
 
-private:
-    Protocol m_protocol;  ///< Protocol filter
-
     /**
-     * @brief Parse port number from string
-     * @param identifier Port as string
-     * @param port Output: parsed port number
-     * @return true if parsing succeeded
+     * @brief Replace the native socket table backend
+     * @param reader Backend to use, or nullptr to always use netstat
      */
-    bool parsePort(const std::string& identifier, uint16_t& port);
+    void setSocketTableReader(std::unique_ptr<SocketTableReader> reader) {
+        m_socketReader = std::move(reader);
+    }
 
     /**
-     * @brief Collect TCP connections for a port using netstat
-     * @param port Port number to query
+     * @brief Parse netstat output to extract connection info
+     *
+     * Only lines whose protocol column starts with the first three
+     * letters of 'protocol' ("tcp" or "udp") are considered. Static and
+     * public so a captured netstat output can be parsed without running
+     * netstat (tests/bench_netstat_parse.cpp).
+     *
+     * @param output Output from netstat command
+     * @param ports Ports we're looking for
+     * @param listeningOnly Only keep listening sockets (matched on local port)
+     * @param protocol Protocol label for matches ("tcp", "tcp6", "udp", "udp6")
      * @param connections Output: vector of connection info
-     * @return true if successful
      */
-    bool collectTcpConnections(uint16_t port, std::vector<ConnectionInfo>& connections);
+    static void parseNetstatOutput(const std::string& output,
+                                   const PortSet& ports,
+                                   bool listeningOnly,
+                                   const std::string& protocol,
+                                   std::vector<ConnectionInfo>& connections);
+
+private:
+    Protocol m_protocol;                              ///< Protocol filter
+    std::unique_ptr<SocketTableReader> m_socketReader; ///< Native backend (may be null)
+    SocketOwnerIndex m_ownerIndex;                    ///< Socket inode -> process index
+    CommandRunner m_runner;                           ///< Runs netstat/lsof
 
     /**
-     * @brief Collect UDP connections for a port using netstat
-     * @param port Port number to query
+     * @brief Collect connections for a port set using the netstat fallback
+     *
+     * Runs netstat once per address family; TCP and UDP lines are
+     * separated in-process.
+     *
+     * @param ports Ports to query
+     * @param listeningOnly Only keep listening sockets
      * @param connections Output: vector of connection info
-     * @return true if successful
      */
-    bool collectUdpConnections(uint16_t port, std::vector<ConnectionInfo>& connections);
+    void collectNetstatConnections(const PortSet& ports, bool listeningOnly,
+                                   std::vector<ConnectionInfo>& connections);
 
     /**
-     * @brief Parse netstat output to extract connection info
-     * @param output Output from netstat command
-     * @param port Port number we're looking for
-     * @param protocol Protocol being parsed ("tcp" or "udp")
-     * @param connections Output: vector of connection info
+     * @brief Parse port number from string
+     * @param identifier Port as string
+     * @param port Output: parsed port number
+     * @return true if parsing succeeded
      */
-    void parseNetstatOutput(const std::string& output,
-                            uint16_t port,
-                            const std::string& protocol,
-                            std::vector<ConnectionInfo>& connections);
+    bool parsePort(const std::string& identifier, uint16_t& port);
 
     /**
-     * @brief Execute a command and capture its output
-     * @param cmd Command to execute
-     * @param output Output: captured stdout
-     * @return true if command succeeded
+     * @brief Run netstat for one address family
+     * @param family "inet" or "inet6"
+     * @param withSocketAddress Whether to pass -A (socket addresses)
+     * @param output Output: netstat's stdout
+     * @return true if netstat ran and produced output or exited with 0
+     */
+    bool runNetstat(const char* family, bool withSocketAddress, std::string& output);
+
+    /**
+     * @brief Fill in PID, process name and user for each connection
+     *
+     * Connections that carry a socket inode are resolved through a
+     * SocketOwnerIndex built once per query. Native table connections
+     * without an inode (TIME_WAIT, orphaned sockets) belong to no process
+     * and are left unowned. Sockets no process is found for keep the
+     * table's user. Connections from netstat fall back
+     * to lsof, run at most once per protocol for the whole set.
+     *
+     * @param ports Ports being queried
+     * @param nativeTable Whether the connections come from a SocketTableReader
+     * @param connections Connections to update in place
      */
-    bool executeCommand(const std::string& cmd, std::string& output);
+    void resolveOwners(const PortSet& ports, bool nativeTable,
+                       std::vector<ConnectionInfo>& connections);
 
     /**
-     * @brief Find process info for a given socket/port
-     * @param port Port number
+     * @brief Find the processes holding sockets on a set of ports
+     * @param ports Ports to look up
      * @param protocol Protocol
-     * @param info Output: connection info to update with PID/process name
+     * @param owners Output: owner (pid, process name, user) per local port
      */
-    void findProcessForPort(uint16_t port,
-                            const std::string& protocol,
-                            ConnectionInfo& info);
+    void findProcessesForPorts(const PortSet& ports,
+                               const std::string& protocol,
+                               std::map<uint16_t, ConnectionInfo>& owners);
 };
 
 } // namespace AixMetadata
@@ -0,0 +1,92 @@
+/**
+ * @file port_set.h
+ * @brief Set of TCP/UDP port numbers backed by a 65536-bit bitmap
+ *
+ * A PortSet lets one pass over the socket tables answer queries for many
+ * ports: each socket is tested with a single bit lookup, whatever the
+ * number of ports requested.
+ *
+ * Port specifications are comma-separated lists of ports and inclusive
+ * ranges, e.g. "22,80,8000-8100".
+ */
+
+#ifndef AIX_METADATA_PORT_SET_H
+#define AIX_METADATA_PORT_SET_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace AixMetadata {
+
+/**
+ * @brief Bitmap of port numbers 0-65535
+ */
+class PortSet {
+public:
+    PortSet();
+
+    /**
+     * @brief Parse a port specification ("22,80,8000-8100")
+     * @param spec Specification; ports must be in 1-65535
+     * @param errorMessage Output: reason for failure
+     * @return false if the specification is malformed (set is unchanged)
+     */
+    bool parse(const std::string& spec, std::string& errorMessage);
+
+    /**
+     * @brief Add a single port
+     */
+    void add(uint16_t port);
+
+    /**
+     * @brief Add an inclusive range of ports
+     */
+    void addRange(uint16_t first, uint16_t last);
+
+    /**
+     * @brief Add every port 1-65535
+     */
+    void addAll();
+
+    /**
+     * @brief Whether a port is in the set
+     */
+    bool contains(uint16_t port) const {
+        return (m_bits[port >> 6] >> (port & 63)) & 1;
+    }
+
+    /**
+     * @brief Number of ports in the set
+     */
+    size_t count() const { return m_count; }
+
+    /**
+     * @brief Whether the set is empty
+     */
+    bool empty() const { return m_count == 0; }
+
+    /**
+     * @brief Whether the set holds every port 1-65535
+     */
+    bool isAll() const { return m_count >= 65535 && !contains(0); }
+
+    /**
+     * @brief The set as sorted, non-overlapping inclusive ranges
+     */
+    std::vector<std::pair<uint16_t, uint16_t>> ranges() const;
+
+    /**
+     * @brief The set as a port specification ("22,80,8000-8100")
+     */
+    std::string toString() const;
+
+private:
+    std::vector<uint64_t> m_bits;  ///< 1024 words, bit N set if port N is in the set
+    size_t m_count;                ///< Number of bits set
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_PORT_SET_H
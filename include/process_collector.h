@@ -14,10 +14,49 @@
 #define AIX_METADATA_PROCESS_COLLECTOR_H
 
 #include "collector_base.h"
+#include "timestamp_formatter.h"
+#include "io_engine.h"
+#include "open_file_list.h"
+#include <string>
+#include <vector>
 #include <sys/types.h>
 
+#ifdef _AIX
+#include <procinfo.h>
+#endif
+
 namespace AixMetadata {
 
+/**
+ * @brief Raw process record that the sub-collectors read from
+ *
+ * The record is fetched once per process and then shared by every
+ * sub-collector, so all attributes describe the same snapshot of the
+ * process. On AIX this holds the procentry64 returned by getprocs64(),
+ * either for a single PID or copied out of a bulk enumeration buffer.
+ * Elsewhere it holds the contents of the /proc files the sub-collectors
+ * parse, read for many processes at once in bulk mode.
+ */
+struct ProcessContext {
+    pid_t pid;                  ///< Process ID
+#ifdef _AIX
+    struct procentry64 entry;   ///< Process table entry from getprocs64()
+#else
+    std::string stat;           ///< /proc/<pid>/stat
+    std::string status;         ///< /proc/<pid>/status
+    std::string cmdline;        ///< /proc/<pid>/cmdline (NUL-separated arguments)
+    bool hasStat;               ///< Whether /proc/<pid>/stat could be opened
+    bool hasStatus;             ///< Whether /proc/<pid>/status could be opened
+    bool hasCmdline;            ///< Whether /proc/<pid>/cmdline could be opened
+#endif
+
+#ifdef _AIX
+    ProcessContext() : pid(0) {}
+#else
+    ProcessContext() : pid(0), hasStat(false), hasStatus(false), hasCmdline(false) {}
+#endif
+};
+
 /**
  * @brief Collects metadata for a process on AIX
  *
@@ -36,7 +75,20 @@ namespace AixMetadata {
  */
 class ProcessCollector : public CollectorBase {
 public:
-    ProcessCollector() = default;
+    /**
+     * @brief Default limit on the bytes of arguments reported per process
+     */
+    static const size_t DEFAULT_COMMAND_LINE_LIMIT = 1024 * 1024;
+
+    /**
+     * @brief Default limit on the open files listed per process
+     */
+    static const size_t DEFAULT_OPEN_FILE_LIMIT = 4096;
+
+    ProcessCollector()
+        : m_commandLineLimit(DEFAULT_COMMAND_LINE_LIMIT),
+          m_openFileLimit(DEFAULT_OPEN_FILE_LIMIT), m_processCount(0),
+          m_kernelFetchCount(0) {}
     ~ProcessCollector() override = default;
 
     /**
@@ -50,7 +102,110 @@ public:
     QueryType getType() const override { return QueryType::Process; }
     std::string getName() const override { return "ProcessCollector"; }
 
+    /**
+     * @brief Number of processes collected by this instance
+     */
+    uint64_t getProcessCount() const { return m_processCount; }
+
+    /**
+     * @brief Number of kernel process table fetches
+     *
+     * getprocs64() calls on AIX, readProcFiles() passes elsewhere. A
+     * single-PID query costs exactly one fetch; a bulk snapshot costs
+     * one fetch per batch.
+     */
+    uint64_t getKernelFetchCount() const { return m_kernelFetchCount; }
+
+    /**
+     * @brief Collect metadata for every process on the system
+     *
+     * The process table is enumerated in bulk (getprocs64() in large
+     * batches on AIX, one /proc directory walk elsewhere) and each
+     * process's metadata is filled from that enumeration. Outside AIX the
+     * /proc files of a batch of processes are read through the IoEngine.
+     *
+     * @param results Output: one MetadataResult per process is appended
+     */
+    void collectAll(std::vector<MetadataResult>& results);
+
+    /**
+     * @brief Formatter used for the start_time attribute
+     */
+    TimestampFormatter& timestamps() { return m_timestamps; }
+
+    /**
+     * @brief Set the limit on the bytes of arguments reported per process
+     *
+     * Longer command lines are cut at the limit and flagged with
+     * cmdline_truncated.
+     *
+     * @param bytes Limit (0: none)
+     */
+    void setCommandLineLimit(size_t bytes) { m_commandLineLimit = bytes; }
+
+    /**
+     * @brief Get the limit on the bytes of arguments reported per process
+     */
+    size_t getCommandLineLimit() const { return m_commandLineLimit; }
+
+    /**
+     * @brief Set the limit on the open files listed per process
+     *
+     * Descriptors beyond the limit are only counted (open_files_count)
+     * and flagged with open_files_truncated.
+     *
+     * @param count Limit (0: none)
+     */
+    void setOpenFileLimit(size_t count) { m_openFileLimit = count; }
+
+    /**
+     * @brief Get the limit on the open files listed per process
+     */
+    size_t getOpenFileLimit() const { return m_openFileLimit; }
+
+    /**
+     * @brief Engine that reads /proc files in bulk mode
+     */
+    const IoEngine& io() const { return m_io; }
+
 private:
+    TimestampFormatter m_timestamps;  ///< Renders start_time
+    IoEngine m_io;                    ///< Batched /proc reads
+    size_t m_commandLineLimit;        ///< Bytes of arguments reported (0: no limit)
+    size_t m_openFileLimit;           ///< Open files listed (0: no limit)
+    OpenFileList m_openFiles;         ///< Descriptor table of the current process
+    uint64_t m_processCount;          ///< Processes collected
+    uint64_t m_kernelFetchCount;      ///< getprocs64() calls / /proc read passes made
+
+    /**
+     * @brief Fetch the raw process record for a PID
+     * @param pid Process ID
+     * @param ctx Output: populated process context
+     * @return false if the process does not exist
+     */
+    bool fetchContext(pid_t pid, ProcessContext& ctx);
+
+#ifndef _AIX
+    /**
+     * @brief Read the /proc files of a batch of processes
+     *
+     * Every file of every process is opened in one engine batch, read in
+     * a second and closed in a third.
+     *
+     * @param contexts Contexts with the PID set; file contents are filled in
+     */
+    void readProcFiles(std::vector<ProcessContext>& contexts);
+#endif
+
+    /**
+     * @brief Build a full result from an already-fetched process record
+     * @param ctx Process context
+     * @param identifier Identifier to report in the result
+     * @return MetadataResult containing all process metadata
+     */
+    MetadataResult collectFromContext(const ProcessContext& ctx,
+                                      const std::string& identifier);
+
     /**
      * @brief Parse PID from string identifier
      * @param identifier PID as string
@@ -61,57 +216,64 @@ private:
 
     /**
      * @brief Collect basic process info using getprocs64()
-     * @param pid Process ID
+     *
+     * On Linux the same attributes are parsed from /proc/<pid>/stat and
+     * /proc/<pid>/status.
+     *
+     * @param ctx Process context
      * @param result Output: MetadataResult to populate
      * @return true if successful
      */
-    bool collectBasicInfo(pid_t pid, MetadataResult& result);
+    bool collectBasicInfo(const ProcessContext& ctx, MetadataResult& result);
 
     /**
-     * @brief Collect command line arguments from /proc
-     * @param pid Process ID
+     * @brief Collect command line arguments (getargs() on AIX, /proc elsewhere)
+     *
+     * Arguments are reported whole, up to the command line limit.
+     *
+     * @param ctx Process context
      * @param result Output: MetadataResult to populate
      */
-    void collectCommandLine(pid_t pid, MetadataResult& result);
+    void collectCommandLine(const ProcessContext& ctx, MetadataResult& result);
 
     /**
      * @brief Collect environment variables from /proc
-     * @param pid Process ID
+     * @param ctx Process context
      * @param result Output: MetadataResult to populate
      */
-    void collectEnvironment(pid_t pid, MetadataResult& result);
+    void collectEnvironment(const ProcessContext& ctx, MetadataResult& result);
 
     /**
-     * @brief Collect open file descriptors
-     * @param pid Process ID
+     * @brief Collect open file descriptors, their count and types
+     * @param ctx Process context
      * @param result Output: MetadataResult to populate
      */
-    void collectOpenFiles(pid_t pid, MetadataResult& result);
+    void collectOpenFiles(const ProcessContext& ctx, MetadataResult& result);
 
     /**
      * @brief Collect executable path
-     * @param pid Process ID
+     * @param ctx Process context
      * @param result Output: MetadataResult to populate
      */
-    void collectExecutablePath(pid_t pid, MetadataResult& result);
+    void collectExecutablePath(const ProcessContext& ctx, MetadataResult& result);
 
     /**
      * @brief Collect current working directory
-     * @param pid Process ID
+     * @param ctx Process context
      * @param result Output: MetadataResult to populate
      */
-    void collectWorkingDirectory(pid_t pid, MetadataResult& result);
+    void collectWorkingDirectory(const ProcessContext& ctx, MetadataResult& result);
 
     /**
      * @brief Collect credential information (effective/real UID/GID)
-     * @param pid Process ID
+     * @param ctx Process context
      * @param result Output: MetadataResult to populate
      */
-    void collectCredentials(pid_t pid, MetadataResult& result);
+    void collectCredentials(const ProcessContext& ctx, MetadataResult& result);
 
     /**
      * @brief Convert process state code to human-readable string
-     * @param state AIX process state code
+     * @param state AIX process state code (Linux: state letter)
      * @return Human-readable state string
      */
     std::string stateToString(unsigned char state);
@@ -136,10 +298,10 @@ private:
      *
      * The WPAR name is resolved by looking up the CID in /etc/corrals/index.
      *
-     * @param pid Process ID
+     * @param ctx Process context
      * @param result Output: MetadataResult to populate with WPAR info
      */
-    void collectWparInfo(pid_t pid, MetadataResult& result);
+    void collectWparInfo(const ProcessContext& ctx, MetadataResult& result);
 };
 
 } // namespace AixMetadata
@@ -0,0 +1,110 @@
+/**
+ * @file query_server.h
+ * @brief Long-running query server on a local Unix domain socket
+ *
+ * Daemon mode keeps one CollectorSet alive and answers queries sent over
+ * a Unix domain socket, so callers avoid fork/exec and dynamic linking
+ * on every query and collector caches stay warm between queries.
+ *
+ * Protocol (NDJSON, one object per line in each direction):
+ *   request:  {"type":"process","id":"1234"}
+ *             {"type":"port","id":"22","protocol":"tcp"}
+ *   response: the compact JsonFormatter output for the query
+ *
+ * Malformed requests are answered with a result whose "success" is false
+ * and whose "error" describes the problem; the connection stays open.
+ */
+
+#ifndef AIX_METADATA_QUERY_SERVER_H
+#define AIX_METADATA_QUERY_SERVER_H
+
+#include "collector_set.h"
+#include <string>
+#include <vector>
+
+namespace AixMetadata {
+
+/**
+ * @brief Serves NDJSON metadata queries on a Unix domain socket
+ *
+ * All clients are multiplexed with poll() on a single thread.
+ */
+class QueryServer {
+public:
+    /**
+     * @brief Constructor
+     * @param socketPath Filesystem path of the listening socket
+     * @param collectors Collectors used to answer queries
+     * @param defaultProtocol Port protocol filter when a request has none
+     */
+    QueryServer(const std::string& socketPath, CollectorSet& collectors,
+                Protocol defaultProtocol = Protocol::Both);
+    ~QueryServer();
+
+    /**
+     * @brief Answer with every value as a JSON string (compatibility mode)
+     * @param enabled Whether to quote all values
+     */
+    void setStringValues(bool enabled) { m_stringValues = enabled; }
+
+    /**
+     * @brief Create, bind and listen on the socket
+     * @param errorMessage Output: reason for failure
+     * @return true if the server is ready to run
+     */
+    bool start(std::string& errorMessage);
+
+    /**
+     * @brief Serve clients until SIGINT/SIGTERM is received
+     * @return Process exit code
+     */
+    int run();
+
+private:
+    /**
+     * @brief Per-client connection state
+     */
+    struct Client {
+        int fd;               ///< Connected socket
+        std::string input;    ///< Bytes received but not yet parsed
+        std::string output;   ///< Responses not yet written
+    };
+
+    std::string m_socketPath;       ///< Listening socket path
+    CollectorSet& m_collectors;     ///< Shared collectors
+    Protocol m_defaultProtocol;     ///< Protocol filter for port queries
+    bool m_stringValues;            ///< Quote all values in responses
+    int m_listenFd;                 ///< Listening socket (-1 if not started)
+    std::vector<Client> m_clients;  ///< Connected clients
+
+    /**
+     * @brief Accept all pending connections
+     */
+    void acceptClients();
+
+    /**
+     * @brief Read from a client and answer every complete request line
+     * @param client Client to service
+     * @return false if the client should be disconnected
+     */
+    bool readClient(Client& client);
+
+    /**
+     * @brief Write as much pending output as the socket accepts
+     * @param client Client to service
+     * @param drain Wait for the socket to drain instead of stopping at EAGAIN
+     * @return false if the client should be disconnected
+     */
+    bool writeClient(Client& client, bool drain);
+
+    /**
+     * @brief Answer a single request line
+     * @param line Request JSON (without trailing newline)
+     * @param output Output: response line is appended
+     */
+    void handleRequest(const std::string& line, std::string& output);
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_QUERY_SERVER_H
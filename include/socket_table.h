@@ -0,0 +1,177 @@
+/**
+ * @file socket_table.h
+ * @brief Native socket table readers used by the port collector
+ *
+ * A socket table reader enumerates the kernel's TCP/UDP socket tables
+ * directly, without spawning netstat or any other helper process.
+ *
+ * Available backends:
+ *   - NetlinkSocketTableReader: NETLINK_SOCK_DIAG dump with an in-kernel
+ *     port filter, so only matching sockets reach userspace (Linux)
+ *   - ProcNetSocketTableReader: parses /proc/net/{tcp,tcp6,udp,udp6} (Linux)
+ *
+ * On Linux the netlink reader is preferred and /proc/net is used when the
+ * sock_diag interface is unavailable (e.g. inet_diag/udp_diag not loaded).
+ *
+ * AIX does not expose its socket tables through /proc, so no native backend
+ * is selected there by default and the PortCollector keeps using netstat.
+ * An AIX backend can be plugged in by implementing SocketTableReader and
+ * handing it to PortCollector::setSocketTableReader().
+ */
+
+#ifndef AIX_METADATA_SOCKET_TABLE_H
+#define AIX_METADATA_SOCKET_TABLE_H
+
+#include "types.h"
+#include "port_set.h"
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+
+namespace AixMetadata {
+
+/**
+ * @brief Information about a single network connection
+ */
+struct ConnectionInfo {
+    std::string protocol;        ///< "tcp", "tcp6", "udp" or "udp6"
+    std::string localAddress;    ///< Local IP address
+    std::string localPort;       ///< Local port number
+    std::string remoteAddress;   ///< Remote IP address (for TCP)
+    std::string remotePort;      ///< Remote port number (for TCP)
+    std::string state;           ///< Connection state (LISTEN, ESTABLISHED, etc.)
+    pid_t pid;                   ///< Process ID (if available)
+    std::string processName;     ///< Process name (if available)
+    std::string user;            ///< User owning the socket (if available)
+    uint64_t inode;              ///< Socket inode (0 if the backend cannot report it)
+    uid_t uid;                   ///< Socket owner UID ((uid_t)-1 if unknown)
+
+    ConnectionInfo() : pid(0), inode(0), uid(static_cast<uid_t>(-1)) {}
+};
+
+/**
+ * @brief Interface for backends that read the kernel socket tables
+ *
+ * Implementations return every socket whose local or remote port is in
+ * the requested port set, restricted to the requested protocol(s). In
+ * listening mode only the local port is matched, and only listening TCP
+ * sockets and unconnected UDP sockets are returned.
+ */
+class SocketTableReader {
+public:
+    virtual ~SocketTableReader() = default;
+
+    /**
+     * @brief Read all sockets using any port of a set, in one table scan
+     * @param ports Ports to match (local or remote)
+     * @param listeningOnly Only return listening sockets, matched on local port
+     * @param proto Protocol filter
+     * @param connections Output: matching connections are appended
+     * @return false if the backend is unavailable (caller should fall back)
+     */
+    virtual bool read(const PortSet& ports, bool listeningOnly, Protocol proto,
+                      std::vector<ConnectionInfo>& connections) = 0;
+
+    /**
+     * @brief Get a human-readable name for this backend
+     * @return String name of the backend
+     */
+    virtual std::string getName() const = 0;
+};
+
+/**
+ * @brief Reads socket tables from /proc/net (Linux)
+ *
+ * Each table is read with a single open()/read() loop into one buffer
+ * and parsed in one pass. Socket inode and owner UID are filled in from
+ * the table so that callers can resolve the owning process.
+ */
+class ProcNetSocketTableReader : public SocketTableReader {
+public:
+    bool read(const PortSet& ports, bool listeningOnly, Protocol proto,
+              std::vector<ConnectionInfo>& connections) override;
+
+    std::string getName() const override { return "procnet"; }
+
+private:
+    /**
+     * @brief Parse one /proc/net table
+     * @param path Table path (e.g. "/proc/net/tcp")
+     * @param protocol Protocol label for matches ("tcp", "tcp6", ...)
+     * @param isTcp Whether the st column holds TCP states
+     * @param isIpv6 Whether addresses are 128-bit
+     * @param ports Ports to match
+     * @param listeningOnly Only return listening sockets
+     * @param connections Output: matching connections are appended
+     * @return true if the table could be read
+     */
+    bool readTable(const char* path, const char* protocol, bool isTcp,
+                   bool isIpv6, const PortSet& ports, bool listeningOnly,
+                   std::vector<ConnectionInfo>& connections);
+};
+
+/**
+ * @brief Queries sockets with NETLINK_SOCK_DIAG (Linux)
+ *
+ * Sends one inet_diag dump request per address family and protocol. The
+ * request carries inet_diag bytecode matching the port set's ranges
+ * against sport (and dport, unless listening), and listening mode
+ * restricts the socket states, so the kernel skips every other socket;
+ * the replies carry the socket inode and owner UID.
+ */
+class NetlinkSocketTableReader : public SocketTableReader {
+public:
+    bool read(const PortSet& ports, bool listeningOnly, Protocol proto,
+              std::vector<ConnectionInfo>& connections) override;
+
+    std::string getName() const override { return "netlink"; }
+
+private:
+    /**
+     * @brief Dump the sockets of one family/protocol using a port
+     * @param fd Netlink socket
+     * @param family AF_INET or AF_INET6
+     * @param ipProtocol IPPROTO_TCP or IPPROTO_UDP
+     * @param ports Ports to match
+     * @param listeningOnly Only return listening sockets
+     * @param connections Output: matching connections are appended
+     * @return false if the kernel rejected the request
+     */
+    bool dump(int fd, int family, int ipProtocol, const PortSet& ports,
+              bool listeningOnly, std::vector<ConnectionInfo>& connections);
+};
+
+/**
+ * @brief Tries a list of readers in order until one succeeds
+ */
+class SocketTableReaderChain : public SocketTableReader {
+public:
+    /**
+     * @brief Append a reader to the end of the chain
+     * @param reader Reader to take ownership of
+     */
+    void add(std::unique_ptr<SocketTableReader> reader);
+
+    /**
+     * @brief Whether the chain holds no readers
+     */
+    bool empty() const { return m_readers.empty(); }
+
+    bool read(const PortSet& ports, bool listeningOnly, Protocol proto,
+              std::vector<ConnectionInfo>& connections) override;
+
+    std::string getName() const override;
+
+private:
+    std::vector<std::unique_ptr<SocketTableReader>> m_readers;  ///< In order of preference
+};
+
+/**
+ * @brief Create the preferred native socket table reader for this platform
+ * @return Reader instance, or nullptr if no native backend exists
+ */
+std::unique_ptr<SocketTableReader> createNativeSocketTableReader();
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_SOCKET_TABLE_H
@@ -0,0 +1,129 @@
+/**
+ * @file timestamp_formatter.h
+ * @brief ISO-8601 local time rendering with a cached UTC offset
+ *
+ * localtime_r() + strftime() cost a timezone lookup (and, in glibc, a
+ * global lock) per timestamp, and each process or file result carries up
+ * to three of them. TimestampFormatter asks the C library for the UTC
+ * offset only when a timestamp falls outside the offset windows it has
+ * already seen: each window is the span around a timestamp in which the
+ * offset does not change, delimited by the surrounding DST transitions.
+ * The date and time digits are then computed arithmetically and written
+ * straight into a fixed buffer.
+ *
+ * Output forms (local time):
+ *   2024-03-05T14:07:09
+ *   2024-03-05T14:07:09.123456789          (nanosecond precision)
+ *   2024-03-05T14:07:09+01:00              (offset suffix; "Z" for UTC)
+ *
+ * The offset is derived from localtime_r() without tm_gmtoff, which AIX
+ * does not provide. A formatter is not thread-safe; use one per thread.
+ */
+
+#ifndef AIX_METADATA_TIMESTAMP_FORMATTER_H
+#define AIX_METADATA_TIMESTAMP_FORMATTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace AixMetadata {
+
+/**
+ * @brief Renders Unix timestamps as ISO-8601 local time
+ */
+class TimestampFormatter {
+public:
+    /**
+     * @brief Fractional-second precision of the output
+     */
+    enum class Precision {
+        Seconds,      ///< 2024-03-05T14:07:09
+        Nanoseconds   ///< 2024-03-05T14:07:09.123456789
+    };
+
+    /// Size of a buffer that holds any formatted timestamp
+    static const size_t MAX_LENGTH = 48;
+
+    /**
+     * @brief Constructor
+     * @param precision Fractional-second precision
+     * @param offsetSuffix Append the UTC offset ("+01:00", or "Z")
+     */
+    explicit TimestampFormatter(Precision precision = Precision::Seconds,
+                                bool offsetSuffix = false);
+
+    void setPrecision(Precision precision) { m_precision = precision; }
+    Precision getPrecision() const { return m_precision; }
+
+    void setOffsetSuffix(bool enabled) { m_offsetSuffix = enabled; }
+    bool hasOffsetSuffix() const { return m_offsetSuffix; }
+
+    /**
+     * @brief Format a timestamp into a caller-supplied buffer
+     * @param seconds Seconds since the Epoch
+     * @param nanoseconds Nanoseconds within the second (0-999999999)
+     * @param out Buffer of at least MAX_LENGTH bytes; not NUL-terminated
+     * @return Number of bytes written, or 0 if the time cannot be converted
+     */
+    size_t format(int64_t seconds, uint32_t nanoseconds, char* out);
+
+    /**
+     * @brief Format a timestamp
+     * @param seconds Seconds since the Epoch
+     * @param nanoseconds Nanoseconds within the second
+     * @return The timestamp, or "unknown" if it cannot be converted
+     */
+    std::string format(int64_t seconds, uint32_t nanoseconds = 0);
+
+    /**
+     * @brief Forget cached offsets (e.g. after the TZ setting changed)
+     *
+     * Also reloads the zone rules, which changes state shared by every
+     * formatter; no other thread may be formatting at the time.
+     */
+    void reset();
+
+    /**
+     * @brief Get the number of timestamps served from a cached offset
+     */
+    uint64_t getCacheHits() const { return m_hits; }
+
+    /**
+     * @brief Get the number of timestamps that needed a new offset window
+     */
+    uint64_t getCacheMisses() const { return m_misses; }
+
+private:
+    /**
+     * @brief Half-open span of time [start, end) with one UTC offset
+     */
+    struct OffsetWindow {
+        int64_t start;
+        int64_t end;
+        int32_t offset;   ///< Seconds east of UTC
+    };
+
+    Precision m_precision;               ///< Fractional-second precision
+    bool m_offsetSuffix;                 ///< Whether to append the offset
+    std::vector<OffsetWindow> m_windows; ///< Disjoint, sorted by start
+    uint64_t m_hits;                     ///< Cached-offset lookups
+    uint64_t m_misses;                   ///< Window computations
+
+    /**
+     * @brief Find the UTC offset in effect at a time
+     * @return false if the C library cannot convert the time
+     */
+    bool lookupOffset(int64_t seconds, int32_t& offset);
+
+    /**
+     * @brief Compute the window of constant offset around a time
+     * @return false if the C library cannot convert the time
+     */
+    bool computeWindow(int64_t seconds, OffsetWindow& window);
+};
+
+} // namespace AixMetadata
+
+#endif // AIX_METADATA_TIMESTAMP_FORMATTER_H
@@ -17,26 +17,130 @@
 
 namespace AixMetadata {
 
+/**
+ * @brief Value type carried by a MetadataAttribute
+ */
+enum class AttributeKind : uint8_t {
+    String,     ///< Single string value
+    Int,        ///< Signed integer
+    UInt,       ///< Unsigned integer
+    Bool,       ///< Boolean
+    List,       ///< List of strings
+    Object,     ///< Nested object; fields are in 'children'
+    ObjectList, ///< Array of objects; each child is an Object
+    PackedList  ///< List of strings packed into values[0], each followed by a NUL
+};
+
 /**
  * @brief Represents a single metadata attribute (key-value pair)
  *
- * Metadata attributes can have multiple values for the same key,
- * which is useful for attributes like "open_file_descriptors" that
- * may have multiple entries.
+ * Numbers and booleans are stored natively so the formatter can emit
+ * them as JSON numbers and booleans. Strings and lists keep their text
+ * in 'values': one element for String, any number for List, which is
+ * useful for attributes like "open_file_descriptors" that may have
+ * multiple entries. A PackedList keeps all its elements in one buffer
+ * (e.g. a process's arguments as read from the kernel), so long lists
+ * cost no allocation per element. Objects and arrays of objects (e.g. the
+ * connections on a port) keep their fields/elements in 'children'.
  */
 struct MetadataAttribute {
     std::string name;                  ///< Attribute name (e.g., "uid", "path", "port")
-    std::vector<std::string> values;   ///< One or more values for this attribute
+    AttributeKind kind;                ///< Which value member is valid
+    union {
+        int64_t intValue;              ///< Value for AttributeKind::Int
+        uint64_t uintValue;            ///< Value for AttributeKind::UInt
+        bool boolValue;                ///< Value for AttributeKind::Bool
+    };
+    std::vector<std::string> values;   ///< Text for String (one) and List (any)
+    std::vector<MetadataAttribute> children;  ///< Object fields / ObjectList elements
+
+    MetadataAttribute() : kind(AttributeKind::List), uintValue(0) {}
 
-    MetadataAttribute() = default;
+    MetadataAttribute(const std::string& n, AttributeKind k)
+        : name(n), kind(k), uintValue(0) {}
 
     MetadataAttribute(const std::string& n, const std::string& v)
-        : name(n) {
+        : name(n), kind(AttributeKind::String), uintValue(0) {
         values.push_back(v);
     }
 
     MetadataAttribute(const std::string& n, const std::vector<std::string>& v)
-        : name(n), values(v) {}
+        : name(n), kind(AttributeKind::List), uintValue(0), values(v) {}
+
+    MetadataAttribute(const std::string& n, int64_t v)
+        : name(n), kind(AttributeKind::Int), intValue(v) {}
+
+    MetadataAttribute(const std::string& n, uint64_t v)
+        : name(n), kind(AttributeKind::UInt), uintValue(v) {}
+
+    MetadataAttribute(const std::string& n, bool v)
+        : name(n), kind(AttributeKind::Bool), uintValue(0) {
+        boolValue = v;
+    }
+
+    /**
+     * @brief Append an element to an ObjectList attribute
+     * @return The new (empty) object; valid until the next addObject()
+     */
+    MetadataAttribute& addObject() {
+        children.emplace_back(std::string(), AttributeKind::Object);
+        return children.back();
+    }
+
+    /**
+     * @brief Add a string field to an Object attribute
+     * @param n Field name
+     * @param v Field value
+     */
+    void addField(const std::string& n, const std::string& v) {
+        children.emplace_back(n, v);
+    }
+
+    /**
+     * @brief Add a string field from a literal (not converted to bool)
+     * @param n Field name
+     * @param v Field value
+     */
+    void addField(const std::string& n, const char* v) {
+        children.emplace_back(n, std::string(v));
+    }
+
+    /**
+     * @brief Add an integer field to an Object attribute
+     * @param n Field name
+     * @param v Field value
+     */
+    void addField(const std::string& n, int64_t v) {
+        children.emplace_back(n, v);
+    }
+
+    /**
+     * @brief Add an unsigned integer field to an Object attribute
+     * @param n Field name
+     * @param v Field value
+     */
+    void addField(const std::string& n, uint64_t v) {
+        children.emplace_back(n, v);
+    }
+
+    /**
+     * @brief Add a boolean field to an Object attribute
+     * @param n Field name
+     * @param v Field value
+     */
+    void addField(const std::string& n, bool v) {
+        children.emplace_back(n, v);
+    }
+
+    /**
+     * @brief Add a nested array-of-objects field to an Object attribute
+     * @param n Field name
+     * @return The new field; valid until the next field is added
+     */
+    MetadataAttribute& addObjectList(const std::string& n) {
+        children.emplace_back(n, AttributeKind::ObjectList);
+        return children.back();
+    }
 };
 
 /**
@@ -64,6 +168,17 @@ struct MetadataResult {
         attributes.emplace_back(name, value);
     }
 
+    /**
+     * @brief Add a string attribute from a literal
+     *
+     * Without this overload a string literal would convert to bool.
+     * @param name Attribute name
+     * @param value Attribute value
+     */
+    void addAttribute(const std::string& name, const char* value) {
+        attributes.emplace_back(name, std::string(value));
+    }
+
     /**
      * @brief Add a multi-value attribute
      * @param name Attribute name
@@ -74,18 +189,65 @@ struct MetadataResult {
     }
 
     /**
-     * @brief Add an integer attribute (converted to string)
+     * @brief Add a list attribute whose elements are packed in one buffer
+     *
+     * Output as a JSON array of strings; with --string-values as one
+     * string with the elements separated by spaces.
+     *
+     * @param name Attribute name
+     * @param packed Elements, each followed by a NUL (moved from)
+     */
+    void addPackedList(const std::string& name, std::string&& packed) {
+        attributes.emplace_back(name, AttributeKind::PackedList);
+        attributes.back().values.push_back(std::move(packed));
+    }
+
+    /**
+     * @brief Add an integer attribute
      * @param name Attribute name
      * @param value Integer value
      */
-    void addAttribute(const std::string& name, int64_t value);
+    void addAttribute(const std::string& name, int64_t value) {
+        attributes.emplace_back(name, value);
+    }
 
     /**
-     * @brief Add an unsigned integer attribute (converted to string)
+     * @brief Add an unsigned integer attribute
      * @param name Attribute name
      * @param value Unsigned integer value
      */
-    void addAttribute(const std::string& name, uint64_t value);
+    void addAttribute(const std::string& name, uint64_t value) {
+        attributes.emplace_back(name, value);
+    }
+
+    /**
+     * @brief Add a boolean attribute
+     * @param name Attribute name
+     * @param value Boolean value
+     */
+    void addAttribute(const std::string& name, bool value) {
+        attributes.emplace_back(name, value);
+    }
+
+    /**
+     * @brief Add an array-of-objects attribute, filled via addObject()
+     * @param name Attribute name
+     * @return The new attribute; valid until the next attribute is added
+     */
+    MetadataAttribute& addObjectList(const std::string& name) {
+        attributes.emplace_back(name, AttributeKind::ObjectList);
+        return attributes.back();
+    }
+
+    /**
+     * @brief Add an object attribute, filled via addField()
+     * @param name Attribute name
+     * @return The new attribute; valid until the next attribute is added
+     */
+    MetadataAttribute& addObject(const std::string& name) {
+        attributes.emplace_back(name, AttributeKind::Object);
+        return attributes.back();
+    }
 };
 
 /**
@@ -97,6 +259,32 @@ enum class QueryType {
     Port        ///< Query by port number
 };
 
+/**
+ * @brief A single metadata query (type plus identifier)
+ */
+struct QueryRequest {
+    QueryType type;          ///< Which collector to use
+    std::string identifier;  ///< PID, file path, or port number
+
+    QueryRequest() : type(QueryType::Process) {}
+    QueryRequest(QueryType t, const std::string& id) : type(t), identifier(id) {}
+};
+
+/**
+ * @brief Parse a query type name ("process", "file" or "port")
+ * @param name Type name
+ * @param type Output: parsed query type
+ * @return true if the name is recognised
+ */
+bool parseQueryType(const std::string& name, QueryType& type);
+
+/**
+ * @brief Describe an errno value, like strerror() but thread-safe
+ * @param err errno value
+ * @return Error description
+ */
+std::string errnoToString(int err);
+
 /**
  * @brief Protocol type for port queries
  */
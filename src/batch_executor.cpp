@@ -0,0 +1,166 @@
+/**
+ * @file batch_executor.cpp
+ * @brief Implementation of the work-stealing batch executor
+ *
+ * Requests are dealt round-robin onto the worker deques, so every worker
+ * starts on the lowest indices it holds and in-order output can be
+ * emitted early. Owners pop from the front, thieves from the back.
+ */
+
+#include "batch_executor.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+
+namespace AixMetadata {
+
+/**
+ * @brief Results of one run(), handed from the workers to the caller
+ */
+struct BatchExecutor::Batch {
+    const std::vector<QueryRequest>& requests;
+
+    std::mutex mutex;                       ///< Guards everything below
+    std::condition_variable ready;          ///< Signalled when a result is stored
+    std::vector<MetadataResult> results;    ///< Indexed by request
+    std::vector<char> done;                 ///< Whether results[i] is stored
+    std::deque<size_t> completed;           ///< Finished indices, in completion order
+    uint64_t steals;                        ///< Queries run by a thief
+
+    explicit Batch(const std::vector<QueryRequest>& r)
+        : requests(r), results(r.size()), done(r.size(), 0), steals(0) {}
+};
+
+BatchExecutor::BatchExecutor(CollectorSet& collectors, size_t workers, Protocol proto)
+    : m_steals(0) {
+    if (workers == 0) {
+        workers = std::thread::hardware_concurrency();
+        if (workers == 0) {
+            workers = 1;
+        }
+    }
+
+    for (size_t i = 0; i < workers; ++i) {
+        std::unique_ptr<Worker> worker(new Worker());
+        if (i == 0) {
+            worker->collectors = &collectors;
+        } else {
+            worker->owned.reset(new CollectorSet(proto));
+            worker->owned->copySettings(collectors);
+            worker->collectors = worker->owned.get();
+        }
+        m_workers.push_back(std::move(worker));
+    }
+}
+
+void BatchExecutor::run(const std::vector<QueryRequest>& requests, Order order,
+                        const ResultSink& sink) {
+    // Serial: no threads, no handoff
+    if (m_workers.size() == 1 || requests.size() <= 1) {
+        for (size_t i = 0; i < requests.size(); ++i) {
+            MetadataResult result = m_workers[0]->collectors->collect(requests[i]);
+            sink(i, result);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        Worker& worker = *m_workers[i % m_workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(i);
+    }
+
+    Batch batch(requests);
+
+    std::vector<std::thread> threads;
+    size_t threadCount = std::min(m_workers.size(), requests.size());
+    threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.push_back(std::thread(&BatchExecutor::work, this, i, std::ref(batch)));
+    }
+
+    // Hand results to the sink as they become deliverable
+    size_t delivered = 0;
+    size_t next = 0;
+    std::unique_lock<std::mutex> lock(batch.mutex);
+
+    while (delivered < requests.size()) {
+        size_t index;
+        if (order == Order::Input) {
+            batch.ready.wait(lock, [&]() { return batch.done[next] != 0; });
+            index = next++;
+        } else {
+            batch.ready.wait(lock, [&]() { return !batch.completed.empty(); });
+            index = batch.completed.front();
+            batch.completed.pop_front();
+        }
+
+        // Run the sink (output I/O) without holding up the workers
+        MetadataResult result = std::move(batch.results[index]);
+        lock.unlock();
+        sink(index, result);
+        lock.lock();
+
+        delivered++;
+    }
+
+    m_steals += batch.steals;
+    lock.unlock();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void BatchExecutor::work(size_t self, Batch& batch) {
+    CollectorSet& collectors = *m_workers[self]->collectors;
+
+    size_t index;
+    bool stolen;
+    while (take(self, index, stolen)) {
+        MetadataResult result = collectors.collect(batch.requests[index]);
+
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        batch.results[index] = std::move(result);
+        batch.done[index] = 1;
+        batch.completed.push_back(index);
+        if (stolen) {
+            batch.steals++;
+        }
+        batch.ready.notify_one();
+    }
+}
+
+bool BatchExecutor::take(size_t self, size_t& index, bool& stolen) {
+    {
+        Worker& own = *m_workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            index = own.tasks.front();
+            own.tasks.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+
+    // Own deque is empty: steal the last queued query of another worker,
+    // starting with the next one so thieves spread over the victims
+    for (size_t i = 1; i < m_workers.size(); ++i) {
+        Worker& victim = *m_workers[(self + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            index = victim.tasks.back();
+            victim.tasks.pop_back();
+            stolen = true;
+            return true;
+        }
+    }
+
+    // Requests are all queued before the workers start, so once every
+    // deque is empty there is nothing left to take
+    return false;
+}
+
+} // namespace AixMetadata
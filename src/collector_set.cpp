@@ -0,0 +1,46 @@
+/**
+ * @file collector_set.cpp
+ * @brief Implementation of the shared collector set
+ */
+
+#include "collector_set.h"
+
+namespace AixMetadata {
+
+CollectorSet::CollectorSet(Protocol proto)
+    : m_port(proto) {
+}
+
+MetadataResult CollectorSet::collect(const QueryRequest& request) {
+    return get(request.type).collect(request.identifier);
+}
+
+CollectorBase& CollectorSet::get(QueryType type) {
+    switch (type) {
+        case QueryType::Process:
+            return m_process;
+        case QueryType::File:
+            return m_file;
+        case QueryType::Port:
+        default:
+            return m_port;
+    }
+}
+
+void CollectorSet::setTimestampFormat(TimestampFormatter::Precision precision,
+                                      bool offsetSuffix) {
+    m_process.timestamps().setPrecision(precision);
+    m_process.timestamps().setOffsetSuffix(offsetSuffix);
+    m_file.timestamps().setPrecision(precision);
+    m_file.timestamps().setOffsetSuffix(offsetSuffix);
+}
+
+void CollectorSet::copySettings(CollectorSet& other) {
+    const TimestampFormatter& source = other.file().timestamps();
+    setTimestampFormat(source.getPrecision(), source.hasOffsetSuffix());
+    setCommandLineLimit(other.process().getCommandLineLimit());
+    setOpenFileLimit(other.process().getOpenFileLimit());
+    setFindOpeners(other.file().getFindOpeners());
+}
+
+} // namespace AixMetadata
@@ -0,0 +1,183 @@
+/**
+ * @file command_runner.cpp
+ * @brief Implementation of the shell-free command runner
+ */
+
+#include "command_runner.h"
+#include "types.h"
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <mutex>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+namespace AixMetadata {
+
+namespace {
+
+// Read size for the output pipe
+const size_t READ_CHUNK = 65536;
+
+// Poll interval while waiting for a child that closed stdout to exit
+const int REAP_INTERVAL_MS = 5;
+
+// Serialises pipe creation and spawning across threads: a pipe end
+// leaked into another thread's child would keep the pipe open, and the
+// reader would not see EOF until that unrelated child exited
+std::mutex g_spawnMutex;
+
+int64_t monotonicMillis() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+int remainingMillis(int64_t deadline) {
+    int64_t left = deadline - monotonicMillis();
+    return left > 0 ? static_cast<int>(left) : 0;
+}
+
+/**
+ * @brief Kill and reap a child that overran its timeout
+ */
+void killChild(pid_t pid) {
+    kill(pid, SIGKILL);
+    while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+    }
+}
+
+} // anonymous namespace
+
+CommandRunner::CommandRunner(int timeoutMs)
+    : m_timeoutMs(timeoutMs) {
+}
+
+bool CommandRunner::run(const std::vector<std::string>& argv, std::string& output,
+                        int* exitStatus) {
+    output.clear();
+    m_lastError.clear();
+    if (exitStatus != nullptr) {
+        *exitStatus = -1;
+    }
+
+    if (argv.empty()) {
+        m_lastError = "No command given";
+        return false;
+    }
+
+    std::vector<char*> args;
+    args.reserve(argv.size() + 1);
+    for (const auto& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    std::unique_lock<std::mutex> spawnLock(g_spawnMutex);
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        m_lastError = std::string("pipe() failed: ") + errnoToString(errno);
+        return false;
+    }
+    // Keep both ends out of any other spawned process; dup2() onto the
+    // child's stdout clears the flag for the copy it uses
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], 1);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+
+    pid_t pid;
+    int rc = posix_spawnp(&pid, args[0], &actions, nullptr, &args[0], environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    spawnLock.unlock();
+
+    if (rc != 0) {
+        close(fds[0]);
+        m_lastError = "Cannot run " + argv[0] + ": " + errnoToString(rc);
+        return false;
+    }
+
+    const int64_t deadline = monotonicMillis() + m_timeoutMs;
+    size_t used = 0;
+    bool timedOut = false;
+
+    for (;;) {
+        struct pollfd pfd;
+        pfd.fd = fds[0];
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int ready = poll(&pfd, 1, remainingMillis(deadline));
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (ready == 0) {
+            timedOut = true;
+            break;
+        }
+
+        if (output.size() - used < READ_CHUNK) {
+            output.resize(used + READ_CHUNK);
+        }
+        ssize_t n = read(fds[0], &output[used], output.size() - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        used += static_cast<size_t>(n);
+    }
+
+    close(fds[0]);
+    output.resize(used);
+
+    // Reap the child, still honouring the deadline
+    int status = 0;
+    while (!timedOut) {
+        pid_t done = waitpid(pid, &status, WNOHANG);
+        if (done == pid) {
+            break;
+        }
+        if (done < 0 && errno != EINTR) {
+            m_lastError = std::string("waitpid() failed: ") + errnoToString(errno);
+            return false;
+        }
+        if (remainingMillis(deadline) == 0) {
+            timedOut = true;
+            break;
+        }
+        poll(nullptr, 0, REAP_INTERVAL_MS);
+    }
+
+    if (timedOut) {
+        killChild(pid);
+        m_lastError = argv[0] + " timed out";
+        return false;
+    }
+
+    if (exitStatus != nullptr && WIFEXITED(status)) {
+        *exitStatus = WEXITSTATUS(status);
+    }
+    return true;
+}
+
+} // namespace AixMetadata
@@ -0,0 +1,579 @@
+/**
+ * @file directory_walker.cpp
+ * @brief Implementation of the parallel directory walker
+ *
+ * Termination: m_pending counts directories queued or being read. A
+ * directory's subdirectories are added to it before the directory itself
+ * is subtracted, so it only reaches zero once the whole tree is done.
+ * Idle workers sleep on m_idle until a task is queued or m_pending drops
+ * to zero.
+ */
+
+#include "directory_walker.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace AixMetadata {
+
+namespace {
+
+// getdents64() buffer per worker; large directories are read in a few calls
+const size_t DIRECTORY_BUFFER_SIZE = 256 * 1024;
+
+// Parent directories kept open for openat() of their subdirectories. Past
+// this, subdirectories are opened by full path instead.
+const size_t MAX_OPEN_DIRECTORIES = 256;
+
+// Stat result of entries whose d_type made a stat unnecessary
+const int NOT_STATED = 1;
+
+/**
+ * @brief Type bit of a mode
+ */
+unsigned typeOf(mode_t mode) {
+    if (S_ISREG(mode))  return WalkOptions::Regular;
+    if (S_ISDIR(mode))  return WalkOptions::Directory;
+    if (S_ISLNK(mode))  return WalkOptions::Symlink;
+    if (S_ISBLK(mode))  return WalkOptions::BlockDevice;
+    if (S_ISCHR(mode))  return WalkOptions::CharacterDevice;
+    if (S_ISFIFO(mode)) return WalkOptions::Fifo;
+    if (S_ISSOCK(mode)) return WalkOptions::Socket;
+    return 0;
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Record layout returned by getdents64()
+ */
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+/**
+ * @brief Type bit of a d_type value (0 if the filesystem did not say)
+ */
+unsigned typeOfDirent(unsigned char type) {
+    switch (type) {
+    case DT_REG:  return WalkOptions::Regular;
+    case DT_DIR:  return WalkOptions::Directory;
+    case DT_LNK:  return WalkOptions::Symlink;
+    case DT_BLK:  return WalkOptions::BlockDevice;
+    case DT_CHR:  return WalkOptions::CharacterDevice;
+    case DT_FIFO: return WalkOptions::Fifo;
+    case DT_SOCK: return WalkOptions::Socket;
+    default:      return 0;
+    }
+}
+
+#endif // __linux__
+
+bool isDotOrDotDot(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/**
+ * @brief Split a comma-separated list, rejecting empty elements
+ */
+bool splitList(const std::string& spec, std::vector<std::string>& items) {
+    size_t start = 0;
+    while (true) {
+        size_t comma = spec.find(',', start);
+        std::string item = spec.substr(start, comma == std::string::npos
+                                                  ? std::string::npos : comma - start);
+        if (item.empty()) {
+            return false;
+        }
+        items.push_back(item);
+        if (comma == std::string::npos) {
+            return true;
+        }
+        start = comma + 1;
+    }
+}
+
+} // anonymous namespace
+
+bool WalkOptions::parseTypes(const std::string& spec, unsigned& mask,
+                             std::string& errorMessage) {
+    std::vector<std::string> items;
+    if (!splitList(spec, items)) {
+        errorMessage = "Invalid type list: " + spec;
+        return false;
+    }
+
+    mask = 0;
+    for (const std::string& item : items) {
+        unsigned bit = 0;
+        if (item.size() == 1) {
+            switch (item[0]) {
+            case 'f': bit = Regular; break;
+            case 'd': bit = Directory; break;
+            case 'l': bit = Symlink; break;
+            case 'b': bit = BlockDevice; break;
+            case 'c': bit = CharacterDevice; break;
+            case 'p': bit = Fifo; break;
+            case 's': bit = Socket; break;
+            default: break;
+            }
+        }
+        if (bit == 0) {
+            errorMessage = "Invalid type '" + item + "' (expected f, d, l, b, c, p or s)";
+            return false;
+        }
+        mask |= bit;
+    }
+    return true;
+}
+
+bool WalkOptions::parsePermissions(const std::string& spec, unsigned& mask,
+                                   std::string& errorMessage) {
+    std::vector<std::string> items;
+    if (!splitList(spec, items)) {
+        errorMessage = "Invalid permission filter: " + spec;
+        return false;
+    }
+
+    mask = 0;
+    for (const std::string& item : items) {
+        if (item == "setuid") {
+            mask |= Setuid;
+        } else if (item == "setgid") {
+            mask |= Setgid;
+        } else if (item == "sticky") {
+            mask |= Sticky;
+        } else if (item == "world-writable") {
+            mask |= WorldWritable;
+        } else {
+            errorMessage = "Invalid permission filter '" + item +
+                           "' (expected setuid, setgid, sticky or world-writable)";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Closes the directory once no queued subdirectory needs it
+ */
+struct DirectoryWalker::DirectoryHandle {
+    int fd;
+    std::atomic<size_t>& openCount;
+
+    DirectoryHandle(int f, std::atomic<size_t>& count) : fd(f), openCount(count) {
+        openCount++;
+    }
+
+    ~DirectoryHandle() {
+        close(fd);
+        openCount--;
+    }
+};
+
+DirectoryWalker::DirectoryWalker(FileCollector& files, size_t workers,
+                                 const WalkOptions& options)
+    : m_options(options),
+      m_sink(nullptr),
+      m_rootDevice(0),
+      m_pending(0),
+      m_queued(0),
+      m_openHandles(0),
+      m_entries(0),
+      m_reported(0),
+      m_directories(0),
+      m_errors(0),
+      m_steals(0) {
+    if (workers == 0) {
+        workers = std::thread::hardware_concurrency();
+        if (workers == 0) {
+            workers = 1;
+        }
+    }
+
+    for (size_t i = 0; i < workers; ++i) {
+        std::unique_ptr<Worker> worker(new Worker());
+        if (i == 0) {
+            worker->files = &files;
+        } else {
+            worker->owned.reset(new FileCollector());
+            worker->owned->timestamps().setPrecision(files.timestamps().getPrecision());
+            worker->owned->timestamps().setOffsetSuffix(files.timestamps().hasOffsetSuffix());
+            worker->files = worker->owned.get();
+        }
+        worker->entryCount = 0;
+        worker->reportedCount = 0;
+        worker->directoryCount = 0;
+        worker->errorCount = 0;
+        worker->stealCount = 0;
+        m_workers.push_back(std::move(worker));
+    }
+}
+
+DirectoryWalker::~DirectoryWalker() = default;
+
+bool DirectoryWalker::run(const std::string& root, const EntrySink& sink) {
+    m_sink = &sink;
+
+    FileStat st;
+    const bool rootFound = statFile(AT_FDCWD, root.c_str(), false, st);
+    if (!rootFound) {
+        reportError(0, root, "Cannot stat file", errno);
+    } else {
+        m_rootDevice = st.device;
+
+        Worker& first = *m_workers[0];
+        first.entryCount++;
+        if (selected(st)) {
+            MetadataResult result = first.files->collectEntry(AT_FDCWD, root.c_str(), root, st);
+            first.reportedCount++;
+            sink(0, result);
+        }
+
+        if (S_ISDIR(st.mode) && m_options.maxDepth != 0) {
+            Task task;
+            task.name = root;
+            task.path = root;
+            task.depth = 0;
+            first.tasks.push_back(std::move(task));
+            m_pending = 1;
+            m_queued = 1;
+
+            // The calling thread is worker 0
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < m_workers.size(); ++i) {
+                threads.push_back(std::thread(&DirectoryWalker::work, this, i));
+            }
+            work(0);
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+    }
+
+    for (auto& worker : m_workers) {
+        m_entries += worker->entryCount;
+        m_reported += worker->reportedCount;
+        m_directories += worker->directoryCount;
+        m_errors += worker->errorCount;
+        m_steals += worker->stealCount;
+        worker->entryCount = 0;
+        worker->reportedCount = 0;
+        worker->directoryCount = 0;
+        worker->errorCount = 0;
+        worker->stealCount = 0;
+    }
+    m_sink = nullptr;
+    return rootFound;
+}
+
+void DirectoryWalker::work(size_t self) {
+    Task task;
+    while (true) {
+        if (take(self, task)) {
+            readDirectory(self, task);
+            task = Task();
+
+            if (m_pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(m_idleMutex);
+                m_idle.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_idleMutex);
+        m_idle.wait(lock, [this]() { return m_pending.load() == 0 || m_queued.load() > 0; });
+        if (m_pending.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool DirectoryWalker::take(size_t self, Task& task) {
+    {
+        // Own deque: newest first, so the walk stays depth-first
+        Worker& own = *m_workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued--;
+            return true;
+        }
+    }
+
+    // Steal the oldest directory of another worker, starting with the
+    // next one so thieves spread over the victims
+    for (size_t i = 1; i < m_workers.size(); ++i) {
+        Worker& victim = *m_workers[(self + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queued--;
+            m_workers[self]->stealCount++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DirectoryWalker::readDirectory(size_t self, Task& task) {
+    Worker& worker = *m_workers[self];
+
+    int fd;
+    if (task.parent) {
+        fd = openat(task.parent->fd, task.name.c_str(),
+                    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    } else {
+        fd = open(task.path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        reportError(self, task.path, "Cannot open directory", errno);
+        return;
+    }
+    task.parent.reset();
+    worker.directoryCount++;
+
+    // Entries listed before a read error are still reported
+    if (!listDirectory(fd, worker)) {
+        reportError(self, task.path, "Cannot read directory", errno);
+    }
+
+    const int childDepth = task.depth + 1;
+    const bool descend = m_options.maxDepth < 0 || childDepth < m_options.maxDepth;
+
+    std::string prefix = task.path;
+    if (prefix.empty() || prefix[prefix.size() - 1] != '/') {
+        prefix += '/';
+    }
+
+    std::vector<Task> children;
+
+    // Entries are stat'ed a batch at a time through the worker's engine
+    IoEngine& io = worker.files->io();
+    const size_t total = worker.entries.size();
+    const size_t batch = std::min<size_t>(total, io.getDepth());
+    worker.stats.resize(batch);
+    worker.statResults.resize(batch);
+
+    for (size_t begin = 0; begin < total; begin += batch) {
+        const size_t end = std::min(total, begin + batch);
+
+        for (size_t i = begin; i < end; i++) {
+            const char* name = worker.names.data() + worker.entries[i].first;
+            const unsigned type = worker.entries[i].second;
+            worker.entryCount++;
+
+            // d_type alone decides entries that can neither be reported nor
+            // crossed into another filesystem, so they need no stat
+            const bool mayReport = type == 0 || m_options.typeMask == 0 ||
+                                   (m_options.typeMask & type) != 0;
+            const bool isDirectory = type == WalkOptions::Directory;
+            if (!mayReport && !(isDirectory && descend && m_options.sameFilesystem)) {
+                worker.statResults[i - begin] = NOT_STATED;
+                continue;
+            }
+            io.stat(fd, name, false, worker.stats[i - begin], worker.statResults[i - begin]);
+        }
+        io.submit();
+
+        for (size_t i = begin; i < end; i++) {
+            const char* name = worker.names.data() + worker.entries[i].first;
+            const int statResult = worker.statResults[i - begin];
+            const FileStat& st = worker.stats[i - begin];
+
+            if (statResult == NOT_STATED) {
+                if (worker.entries[i].second == WalkOptions::Directory && descend) {
+                    Task child;
+                    child.name = name;
+                    child.path = prefix + name;
+                    child.depth = childDepth;
+                    children.push_back(std::move(child));
+                }
+                continue;
+            }
+
+            std::string path = prefix + name;
+
+            if (statResult < 0) {
+                reportError(self, path, "Cannot stat file", -statResult);
+                continue;
+            }
+
+            if (selected(st)) {
+                MetadataResult result = worker.files->collectEntry(fd, name, path, st);
+                worker.reportedCount++;
+                (*m_sink)(self, result);
+            }
+
+            if (S_ISDIR(st.mode) && descend &&
+                (!m_options.sameFilesystem || st.device == m_rootDevice)) {
+                Task child;
+                child.name = name;
+                child.path = std::move(path);
+                child.depth = childDepth;
+                children.push_back(std::move(child));
+            }
+        }
+    }
+
+    if (children.empty()) {
+        close(fd);
+        return;
+    }
+
+    // Keep this directory open for openat() of the children, unless too
+    // many parents are open already
+    std::shared_ptr<DirectoryHandle> handle;
+    if (m_openHandles.load() < MAX_OPEN_DIRECTORIES) {
+        handle = std::make_shared<DirectoryHandle>(fd, m_openHandles);
+    } else {
+        close(fd);
+    }
+
+    m_pending += children.size();
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        // Reversed, so the worker pops them in directory order
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+            it->parent = handle;
+            worker.tasks.push_back(std::move(*it));
+        }
+    }
+    m_queued += children.size();
+
+    if (m_workers.size() > 1) {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_idle.notify_all();
+    }
+}
+
+bool DirectoryWalker::listDirectory(int fd, Worker& worker) {
+    worker.names.clear();
+    worker.entries.clear();
+
+#ifdef __linux__
+    if (worker.buffer.empty()) {
+        worker.buffer.resize(DIRECTORY_BUFFER_SIZE);
+    }
+
+    while (true) {
+        long bytes = syscall(SYS_getdents64, fd, worker.buffer.data(), worker.buffer.size());
+        if (bytes < 0) {
+            return false;
+        }
+        if (bytes == 0) {
+            return true;
+        }
+
+        for (long offset = 0; offset < bytes;) {
+            const LinuxDirent64* dirent =
+                reinterpret_cast<const LinuxDirent64*>(worker.buffer.data() + offset);
+            offset += dirent->d_reclen;
+
+            if (isDotOrDotDot(dirent->d_name)) {
+                continue;
+            }
+            worker.entries.emplace_back(worker.names.size(), typeOfDirent(dirent->d_type));
+            worker.names.append(dirent->d_name);
+            worker.names.push_back('\0');
+        }
+    }
+#else
+    // readdir() on its own descriptor; ours stays open for fstatat()
+    int dirFd = dup(fd);
+    if (dirFd < 0) {
+        return false;
+    }
+    DIR* dir = fdopendir(dirFd);
+    if (dir == nullptr) {
+        int err = errno;
+        close(dirFd);
+        errno = err;
+        return false;
+    }
+
+    bool ok = true;
+    while (true) {
+        errno = 0;
+        struct dirent* dirent = readdir(dir);
+        if (dirent == nullptr) {
+            ok = (errno == 0);
+            break;
+        }
+        if (isDotOrDotDot(dirent->d_name)) {
+            continue;
+        }
+        // No d_type on AIX: every entry is stat'ed
+        worker.entries.emplace_back(worker.names.size(), 0u);
+        worker.names.append(dirent->d_name);
+        worker.names.push_back('\0');
+    }
+
+    int err = errno;
+    closedir(dir);
+    errno = err;
+    return ok;
+#endif
+}
+
+bool DirectoryWalker::selected(const FileStat& st) const {
+    if (m_options.typeMask != 0 && (m_options.typeMask & typeOf(st.mode)) == 0) {
+        return false;
+    }
+
+    if (m_options.permissionMask != 0) {
+        unsigned properties = 0;
+        if (st.mode & S_ISUID) {
+            properties |= WalkOptions::Setuid;
+        }
+        if (st.mode & S_ISGID) {
+            properties |= WalkOptions::Setgid;
+        }
+        if (st.mode & S_ISVTX) {
+            properties |= WalkOptions::Sticky;
+        }
+        if ((st.mode & S_IWOTH) && !S_ISLNK(st.mode)) {
+            properties |= WalkOptions::WorldWritable;
+        }
+        if ((properties & m_options.permissionMask) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void DirectoryWalker::reportError(size_t self, const std::string& path,
+                                  const std::string& what, int err) {
+    MetadataResult result;
+    result.type = "file";
+    result.identifier = path;
+    result.success = false;
+
+    std::ostringstream errMsg;
+    errMsg << what << " '" << path << "': " << errnoToString(err);
+    result.errorMessage = errMsg.str();
+
+    m_workers[self]->errorCount++;
+    (*m_sink)(self, result);
+}
+
+} // namespace AixMetadata
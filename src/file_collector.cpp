@@ -7,40 +7,27 @@
  * portable across UNIX systems including AIX.
  *
  * APIs used:
- *   - stat64(): File attributes (size, permissions, times, etc.)
- *   - lstat64(): Symlink attributes
- *   - readlink(): Symlink target resolution
- *   - access(): Check current user's access permissions
- *   - getpwuid()/getgrgid(): Owner/group name resolution
+ *   - statFile(): File attributes in one call (statx() on Linux,
+ *     lstat64()/stat64() equivalents elsewhere)
+ *   - readlinkat(): Symlink target resolution
+ *   - AccessChecker: Current user's access permissions, from the file
+ *     status where possible, otherwise faccessat()
+ *   - IdentityCache: Owner/group name resolution
+ *   - OpenerScanner: Processes holding the file open
  */
 
 #include "file_collector.h"
+#include "identity_cache.h"
 
+#include <climits>
 #include <cstring>
 #include <cerrno>
 #include <sstream>
+#include <fcntl.h>
 #include <unistd.h>
-#include <pwd.h>
-#include <grp.h>
-#include <time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
-// Include header for major()/minor() macros - location varies by platform
-// On AIX and most UNIX systems, these are in sys/sysmacros.h
-// On some systems they may be in sys/mkdev.h or sys/types.h
-#ifdef _AIX
-#include <sys/sysmacros.h>
-#include <sys/statfs.h>
-#else
-// For other platforms, try sysmacros.h first
-#if __has_include(<sys/sysmacros.h>)
-#include <sys/sysmacros.h>
-#elif __has_include(<sys/mkdev.h>)
-#include <sys/mkdev.h>
-#endif
-#endif
-
 namespace AixMetadata {
 
 MetadataResult FileCollector::collect(const std::string& identifier) {
@@ -52,118 +39,144 @@ MetadataResult FileCollector::collect(const std::string& identifier) {
         return createErrorResult(identifier, "Empty file path");
     }
 
-    // Collect file statistics
-    if (!collectStats(identifier, result)) {
-        return result;  // Error already set in collectStats
+    // First, stat the path itself (not following symlinks)
+    FileStat linkStat;
+    if (!statFile(AT_FDCWD, identifier.c_str(), false, linkStat)) {
+        int err = errno;
+        std::ostringstream errMsg;
+        errMsg << "Cannot stat file '" << identifier << "': " << errnoToString(err);
+        result.success = false;
+        result.errorMessage = errMsg.str();
+        return result;
     }
 
+    return collectEntry(AT_FDCWD, identifier.c_str(), identifier, linkStat);
+}
+
+MetadataResult FileCollector::collectEntry(int dirfd, const char* name,
+                                           const std::string& path,
+                                           const FileStat& linkStat) {
+    MetadataResult result;
+    result.type = "file";
+    result.identifier = path;
+
+    // Collect file statistics
+    FileStat target;
+    collectStats(dirfd, name, linkStat, result, target);
+
     result.success = true;
 
     // Collect access information for current user
-    collectAccessInfo(identifier, result);
+    collectAccessInfo(dirfd, name, target, result);
+
+    // A broken symlink has no file to be held open
+    if (m_findOpeners && target.mode != 0) {
+        collectOpeners(target, result);
+    }
 
     return result;
 }
 
-bool FileCollector::collectStats(const std::string& path, MetadataResult& result) {
-    struct stat64 statBuf;
-    struct stat64 lstatBuf;
-
-    // First, use lstat64 to get info about the path itself (not following symlinks)
-    if (lstat64(path.c_str(), &lstatBuf) != 0) {
-        int err = errno;
-        std::ostringstream errMsg;
-        errMsg << "Cannot stat file '" << path << "': " << strerror(err);
-        result.success = false;
-        result.errorMessage = errMsg.str();
-        return false;
-    }
+void FileCollector::collectStats(int dirfd, const char* name, const FileStat& linkStat,
+                                 MetadataResult& result, FileStat& target) {
+    FileStat statBuf;
 
     // Check if it's a symlink
-    bool isSymlink = S_ISLNK(lstatBuf.st_mode);
+    bool isSymlink = S_ISLNK(linkStat.mode);
 
     // If it's a symlink, also stat the target
     if (isSymlink) {
-        if (stat64(path.c_str(), &statBuf) != 0) {
+        if (statFile(dirfd, name, true, statBuf)) {
+            target = statBuf;
+        } else {
             // Symlink target doesn't exist or is inaccessible
-            // We still have lstat info, so we can report partial data
-            result.addAttribute("symlink_broken", "true");
-            // Use lstat data for the rest
-            memcpy(&statBuf, &lstatBuf, sizeof(statBuf));
+            // We still have the link's own info, so we can report partial data
+            result.addAttribute("symlink_broken", true);
+            // Use the link's data for the rest
+            statBuf = linkStat;
         }
-        collectSymlinkInfo(path, lstatBuf, result);
+        collectSymlinkInfo(dirfd, name, result);
     } else {
-        memcpy(&statBuf, &lstatBuf, sizeof(statBuf));
+        statBuf = linkStat;
+        target = statBuf;
     }
 
     // File type
-    result.addAttribute("type", fileTypeToString(lstatBuf.st_mode));
+    result.addAttribute("type", fileTypeToString(linkStat.mode));
 
     // Size (in bytes)
-    result.addAttribute("size", static_cast<uint64_t>(statBuf.st_size));
+    result.addAttribute("size", statBuf.size);
 
     // Device ID
-    result.addAttribute("device", static_cast<uint64_t>(statBuf.st_dev));
+    result.addAttribute("device", statBuf.device);
+
+    // Mount ID (Linux 5.8+)
+    if (statBuf.hasMountId) {
+        result.addAttribute("mount_id", statBuf.mountId);
+    }
 
     // Inode number
-    result.addAttribute("inode", static_cast<uint64_t>(statBuf.st_ino));
+    result.addAttribute("inode", statBuf.inode);
 
     // Number of hard links
-    result.addAttribute("nlink", static_cast<uint64_t>(statBuf.st_nlink));
+    result.addAttribute("nlink", statBuf.nlink);
 
     // Permissions - octal format
     std::ostringstream modeOctal;
-    modeOctal << "0" << std::oct << (statBuf.st_mode & 07777);
+    modeOctal << "0" << std::oct << (statBuf.mode & 07777);
     result.addAttribute("mode_octal", modeOctal.str());
 
     // Permissions - symbolic format
-    result.addAttribute("mode_symbolic", modeToSymbolic(statBuf.st_mode));
+    result.addAttribute("mode_symbolic", modeToSymbolic(statBuf.mode));
 
     // Special bits
-    if (statBuf.st_mode & S_ISUID) {
-        result.addAttribute("setuid", "true");
+    if (statBuf.mode & S_ISUID) {
+        result.addAttribute("setuid", true);
     }
-    if (statBuf.st_mode & S_ISGID) {
-        result.addAttribute("setgid", "true");
+    if (statBuf.mode & S_ISGID) {
+        result.addAttribute("setgid", true);
     }
-    if (statBuf.st_mode & S_ISVTX) {
-        result.addAttribute("sticky", "true");
+    if (statBuf.mode & S_ISVTX) {
+        result.addAttribute("sticky", true);
     }
 
     // Owner and group information
     collectOwnership(statBuf, result);
 
     // Timestamps
-    result.addAttribute("access_time", timeToString(statBuf.st_atime));
-    result.addAttribute("modify_time", timeToString(statBuf.st_mtime));
-    result.addAttribute("change_time", timeToString(statBuf.st_ctime));
+    result.addAttribute("access_time", timeToString(statBuf.accessTime));
+    result.addAttribute("modify_time", timeToString(statBuf.modifyTime));
+    result.addAttribute("change_time", timeToString(statBuf.changeTime));
+    if (statBuf.hasBirthTime) {
+        result.addAttribute("birth_time", timeToString(statBuf.birthTime));
+    }
 
     // Epoch timestamps (for programmatic use)
-    result.addAttribute("atime_epoch", static_cast<int64_t>(statBuf.st_atime));
-    result.addAttribute("mtime_epoch", static_cast<int64_t>(statBuf.st_mtime));
-    result.addAttribute("ctime_epoch", static_cast<int64_t>(statBuf.st_ctime));
+    result.addAttribute("atime_epoch", statBuf.accessTime.seconds);
+    result.addAttribute("mtime_epoch", statBuf.modifyTime.seconds);
+    result.addAttribute("ctime_epoch", statBuf.changeTime.seconds);
+    if (statBuf.hasBirthTime) {
+        result.addAttribute("btime_epoch", statBuf.birthTime.seconds);
+    }
 
     // Block size and blocks used
-    result.addAttribute("block_size", static_cast<int64_t>(statBuf.st_blksize));
-    result.addAttribute("blocks", static_cast<int64_t>(statBuf.st_blocks));
+    result.addAttribute("block_size", statBuf.blockSize);
+    result.addAttribute("blocks", statBuf.blocks);
 
     // For device files, report major/minor numbers
-    if (S_ISBLK(statBuf.st_mode) || S_ISCHR(statBuf.st_mode)) {
-        result.addAttribute("rdev_major", static_cast<int64_t>(major(statBuf.st_rdev)));
-        result.addAttribute("rdev_minor", static_cast<int64_t>(minor(statBuf.st_rdev)));
+    if (S_ISBLK(statBuf.mode) || S_ISCHR(statBuf.mode)) {
+        result.addAttribute("rdev_major", static_cast<int64_t>(statBuf.rdevMajor));
+        result.addAttribute("rdev_minor", static_cast<int64_t>(statBuf.rdevMinor));
     }
 
-    return true;
 }
 
-void FileCollector::collectSymlinkInfo(const std::string& path,
-                                        const struct stat64& /* statBuf */,
-                                        MetadataResult& result) {
-    result.addAttribute("is_symlink", "true");
+void FileCollector::collectSymlinkInfo(int dirfd, const char* name, MetadataResult& result) {
+    result.addAttribute("is_symlink", true);
 
     // Read the symlink target
     char linkTarget[PATH_MAX];
-    ssize_t len = readlink(path.c_str(), linkTarget, sizeof(linkTarget) - 1);
+    ssize_t len = readlinkat(dirfd, name, linkTarget, sizeof(linkTarget) - 1);
 
     if (len > 0) {
         linkTarget[len] = '\0';
@@ -180,39 +193,66 @@ void FileCollector::collectSymlinkInfo(const std::string& path,
     }
 }
 
-void FileCollector::collectOwnership(const struct stat64& statBuf, MetadataResult& result) {
+void FileCollector::collectOwnership(const FileStat& statBuf, MetadataResult& result) {
     // User ID
-    result.addAttribute("uid", static_cast<int64_t>(statBuf.st_uid));
+    result.addAttribute("uid", static_cast<int64_t>(statBuf.uid));
 
     // Resolve username
-    struct passwd* pwd = getpwuid(statBuf.st_uid);
-    if (pwd != nullptr) {
-        result.addAttribute("owner", std::string(pwd->pw_name));
+    std::string owner;
+    if (IdentityCache::instance().lookupUser(statBuf.uid, owner)) {
+        result.addAttribute("owner", owner);
     } else {
         result.addAttribute("owner", "unknown");
     }
 
     // Group ID
-    result.addAttribute("gid", static_cast<int64_t>(statBuf.st_gid));
+    result.addAttribute("gid", static_cast<int64_t>(statBuf.gid));
 
     // Resolve group name
-    struct group* grp = getgrgid(statBuf.st_gid);
-    if (grp != nullptr) {
-        result.addAttribute("group", std::string(grp->gr_name));
+    std::string group;
+    if (IdentityCache::instance().lookupGroup(statBuf.gid, group)) {
+        result.addAttribute("group", group);
     } else {
         result.addAttribute("group", "unknown");
     }
 }
 
-void FileCollector::collectAccessInfo(const std::string& path, MetadataResult& result) {
-    // Check what access the current user has
-    bool readable = (access(path.c_str(), R_OK) == 0);
-    bool writable = (access(path.c_str(), W_OK) == 0);
-    bool executable = (access(path.c_str(), X_OK) == 0);
+void FileCollector::collectAccessInfo(int dirfd, const char* name, const FileStat& target,
+                                      MetadataResult& result) {
+    // A broken symlink grants nothing, as access() would report
+    FileAccess access;
+    if (target.mode != 0) {
+        access = m_access.check(dirfd, name, target);
+    }
 
-    result.addAttribute("current_user_readable", readable ? "true" : "false");
-    result.addAttribute("current_user_writable", writable ? "true" : "false");
-    result.addAttribute("current_user_executable", executable ? "true" : "false");
+    result.addAttribute("current_user_readable", access.readable);
+    result.addAttribute("current_user_writable", access.writable);
+    result.addAttribute("current_user_executable", access.executable);
+}
+
+void FileCollector::collectOpeners(const FileStat& target, MetadataResult& result) {
+    std::vector<FileOpener> openers;
+    if (!m_openers.find(target.device, target.inode, openers)) {
+        return;
+    }
+
+    MetadataAttribute& list = result.addObjectList("openers");
+    for (const FileOpener& opener : openers) {
+        MetadataAttribute& entry = list.addObject();
+        entry.addField("pid", static_cast<int64_t>(opener.pid));
+        entry.addField("fd", static_cast<int64_t>(opener.fd));
+        entry.addField("comm", opener.processName);
+        if (opener.uid == static_cast<uid_t>(-1)) {
+            // Process exited before it could be described
+            continue;
+        }
+        entry.addField("uid", static_cast<int64_t>(opener.uid));
+
+        std::string user;
+        if (IdentityCache::instance().lookupUser(opener.uid, user)) {
+            entry.addField("user", user);
+        }
+    }
 }
 
 std::string FileCollector::fileTypeToString(mode_t mode) {
@@ -260,16 +300,8 @@ std::string FileCollector::modeToSymbolic(mode_t mode) {
     return std::string(symbolic);
 }
 
-std::string FileCollector::timeToString(time_t timeVal) {
-    struct tm* tm_info = localtime(&timeVal);
-
-    if (tm_info == nullptr) {
-        return "unknown";
-    }
-
-    char buffer[32];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", tm_info);
-    return std::string(buffer);
+std::string FileCollector::timeToString(const FileTime& time) {
+    return m_timestamps.format(time.seconds, time.nanoseconds);
 }
 
 } // namespace AixMetadata
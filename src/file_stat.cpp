@@ -0,0 +1,504 @@
+/**
+ * @file file_stat.cpp
+ * @brief Implementation of file status and access checks
+ *
+ * The userspace access check follows the kernel's generic_permission():
+ * the owner, group or other bits apply (in that order of precedence),
+ * and if they deny, CAP_DAC_OVERRIDE grants anything except executing a
+ * file with no execute bit at all, while CAP_DAC_READ_SEARCH grants
+ * reading files and reading/searching directories. On top of that,
+ * faccessat() denies writes on read-only mounts (regular files,
+ * directories and symlinks only) and to immutable files, and executing
+ * regular files on noexec mounts.
+ */
+
+#include "file_stat.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// major()/minor()/makedev() - location varies by platform
+#ifdef _AIX
+#include <sys/sysmacros.h>
+#else
+#if __has_include(<sys/sysmacros.h>)
+#include <sys/sysmacros.h>
+#elif __has_include(<sys/mkdev.h>)
+#include <sys/mkdev.h>
+#endif
+#endif
+
+#ifdef __linux__
+#include <atomic>
+#include <sys/statfs.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/xattr.h>
+#include <linux/capability.h>
+#endif
+
+// glibc 2.28+ declares statx()
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+#define HAVE_STATX 1
+#ifndef STATX_MNT_ID
+#define STATX_MNT_ID 0x1000U
+#endif
+#endif
+
+// Sub-second part of a stat timestamp. Linux and AIX 7 both provide
+// POSIX.1-2008 st_atim/st_mtim/st_ctim; elsewhere report whole seconds.
+#if defined(__linux__) || defined(_AIX)
+#define STAT_NSEC(buf, field) static_cast<uint32_t>((buf).field.tv_nsec)
+#else
+#define STAT_NSEC(buf, field) 0u
+#endif
+
+namespace AixMetadata {
+
+namespace {
+
+// Large-file stat for the fallback path. On AIX, _LARGE_FILES (set by the
+// Makefile) makes struct stat and fstatat() 64-bit.
+#ifdef __linux__
+typedef struct stat64 StatBuffer;
+inline int statAt(int dirfd, const char* path, StatBuffer* buf, int flags) {
+    return fstatat64(dirfd, path, buf, flags);
+}
+#else
+typedef struct stat StatBuffer;
+inline int statAt(int dirfd, const char* path, StatBuffer* buf, int flags) {
+    return fstatat(dirfd, path, buf, flags);
+}
+#endif
+
+void fromStat(const StatBuffer& buf, FileStat& st) {
+    st.mode = buf.st_mode;
+    st.device = static_cast<uint64_t>(buf.st_dev);
+    st.inode = static_cast<uint64_t>(buf.st_ino);
+    st.nlink = static_cast<uint64_t>(buf.st_nlink);
+    st.uid = buf.st_uid;
+    st.gid = buf.st_gid;
+    st.size = static_cast<uint64_t>(buf.st_size);
+    st.blockSize = static_cast<int64_t>(buf.st_blksize);
+    st.blocks = static_cast<int64_t>(buf.st_blocks);
+    st.rdevMajor = static_cast<uint32_t>(major(buf.st_rdev));
+    st.rdevMinor = static_cast<uint32_t>(minor(buf.st_rdev));
+    st.accessTime.seconds = static_cast<int64_t>(buf.st_atime);
+    st.accessTime.nanoseconds = STAT_NSEC(buf, st_atim);
+    st.modifyTime.seconds = static_cast<int64_t>(buf.st_mtime);
+    st.modifyTime.nanoseconds = STAT_NSEC(buf, st_mtim);
+    st.changeTime.seconds = static_cast<int64_t>(buf.st_ctime);
+    st.changeTime.nanoseconds = STAT_NSEC(buf, st_ctim);
+}
+
+#ifdef HAVE_STATX
+
+// Everything the file collector reports, and nothing else
+const unsigned STATX_FIELDS = STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID |
+                              STATX_GID | STATX_ATIME | STATX_MTIME | STATX_CTIME |
+                              STATX_INO | STATX_SIZE | STATX_BLOCKS | STATX_BTIME |
+                              STATX_MNT_ID;
+
+// Set once statx() has been seen to be blocked (e.g. by an old container
+// seccomp profile that answers EPERM) while fstatat() works
+std::atomic<bool> g_statxBlocked(false);
+
+FileTime fromStatx(const struct statx_timestamp& ts) {
+    FileTime time;
+    time.seconds = static_cast<int64_t>(ts.tv_sec);
+    time.nanoseconds = ts.tv_nsec;
+    return time;
+}
+
+void fromStatx(const struct statx& buf, FileStat& st) {
+    st.mode = buf.stx_mode;
+    st.device = static_cast<uint64_t>(makedev(buf.stx_dev_major, buf.stx_dev_minor));
+    st.inode = buf.stx_ino;
+    st.nlink = buf.stx_nlink;
+    st.uid = buf.stx_uid;
+    st.gid = buf.stx_gid;
+    st.size = buf.stx_size;
+    st.blockSize = static_cast<int64_t>(buf.stx_blksize);
+    st.blocks = static_cast<int64_t>(buf.stx_blocks);
+    st.rdevMajor = buf.stx_rdev_major;
+    st.rdevMinor = buf.stx_rdev_minor;
+    st.accessTime = fromStatx(buf.stx_atime);
+    st.modifyTime = fromStatx(buf.stx_mtime);
+    st.changeTime = fromStatx(buf.stx_ctime);
+
+    // Some image builders leave a zero creation time; treat it as unknown
+    st.hasBirthTime = (buf.stx_mask & STATX_BTIME) != 0 &&
+                      (buf.stx_btime.tv_sec != 0 || buf.stx_btime.tv_nsec != 0);
+    if (st.hasBirthTime) {
+        st.birthTime = fromStatx(buf.stx_btime);
+    }
+
+    st.hasMountId = (buf.stx_mask & STATX_MNT_ID) != 0;
+    if (st.hasMountId) {
+        st.mountId = buf.stx_mnt_id;
+    }
+
+    st.immutableKnown = (buf.stx_attributes_mask & STATX_ATTR_IMMUTABLE) != 0;
+    st.immutable = (buf.stx_attributes & STATX_ATTR_IMMUTABLE) != 0;
+}
+
+#endif // HAVE_STATX
+
+#ifdef __linux__
+
+// How long mount flags are trusted (mount IDs are reused after umount)
+const int64_t MOUNT_FLAGS_TTL = 60;
+
+// Mounts remembered before the cache is cleared
+const size_t MAX_MOUNTS = 1024;
+
+// Owner ID the kernel reports for IDs not mapped into our user namespace;
+// capabilities do not apply to such inodes
+const uid_t OVERFLOW_ID = 65534;
+
+/**
+ * @brief Whether a /proc/self/{uid,gid}_map is the initial namespace's
+ *        identity map, under which every ID is mapped
+ */
+bool isIdentityMap(const char* path) {
+    FILE* file = fopen(path, "re");
+    if (file == nullptr) {
+        return false;
+    }
+
+    unsigned long inside = 1;
+    unsigned long outside = 1;
+    unsigned long count = 0;
+    int fields = fscanf(file, "%lu %lu %lu", &inside, &outside, &count);
+    int extra;
+    bool single = (fields == 3) && (fscanf(file, "%d", &extra) != 1);
+    fclose(file);
+
+    return single && inside == 0 && outside == 0 && count == 4294967295UL;
+}
+
+int64_t monotonicSeconds() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return static_cast<int64_t>(time(nullptr));
+    }
+    return static_cast<int64_t>(ts.tv_sec);
+}
+
+/**
+ * @brief Whether something other than the mode bits decides access
+ */
+bool isDelegatedFilesystem(uint32_t magic) {
+    switch (magic) {
+    case 0x6969:        // NFS
+    case 0x517B:        // SMB
+    case 0xFF534D42:    // CIFS
+    case 0xFE534D42:    // SMB2
+    case 0x65735546:    // FUSE
+    case 0x00C36400:    // Ceph
+    case 0x5346414F:    // OpenAFS
+    case 0x6B414653:    // kAFS
+    case 0x73757245:    // Coda
+    case 0x01021997:    // 9P
+    case 0x9FA0:        // procfs: own rules, e.g. for /proc/self/fd
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Whether a file has a POSIX access ACL
+ * @return 1 if it has, 0 if not, -1 if unknown
+ */
+int hasAccessAcl(int dirfd, const char* path) {
+    // getxattr() has no dirfd form; reach the entry through procfs
+    char fdPath[PATH_MAX];
+    if (dirfd != AT_FDCWD && path[0] != '/') {
+        int length = snprintf(fdPath, sizeof(fdPath), "/proc/self/fd/%d/%s", dirfd, path);
+        if (length < 0 || static_cast<size_t>(length) >= sizeof(fdPath)) {
+            return -1;
+        }
+        path = fdPath;
+    }
+
+    if (getxattr(path, "system.posix_acl_access", nullptr, 0) >= 0) {
+        return 1;
+    }
+    if (errno == ENODATA || errno == ENOTSUP || errno == EOPNOTSUPP) {
+        return 0;
+    }
+    return -1;
+}
+
+#endif // __linux__
+
+} // anonymous namespace
+
+bool statFile(int dirfd, const char* path, bool followLinks, FileStat& st) {
+    st = FileStat();
+    const int flags = followLinks ? 0 : AT_SYMLINK_NOFOLLOW;
+
+#ifdef HAVE_STATX
+    bool statxFailed = false;
+    if (!g_statxBlocked.load(std::memory_order_relaxed)) {
+        struct statx buf;
+        // stat() never automounts the last component; match it
+        if (statx(dirfd, path, flags | AT_NO_AUTOMOUNT, STATX_FIELDS, &buf) == 0) {
+            fromStatx(buf, st);
+            return true;
+        }
+        if (errno != ENOSYS && errno != EPERM) {
+            return false;
+        }
+        statxFailed = true;
+    }
+#endif
+
+    StatBuffer buf;
+    if (statAt(dirfd, path, &buf, flags) != 0) {
+        return false;
+    }
+
+#ifdef HAVE_STATX
+    if (statxFailed) {
+        g_statxBlocked.store(true, std::memory_order_relaxed);
+    }
+#endif
+
+    fromStat(buf, st);
+    return true;
+}
+
+#ifdef HAVE_STATX
+
+unsigned statxFileMask() {
+    return STATX_FIELDS;
+}
+
+void fileStatFromStatx(const struct statx& buf, FileStat& st) {
+    st = FileStat();
+    fromStatx(buf, st);
+}
+
+#endif
+
+AccessChecker::AccessChecker()
+    : m_loaded(false),
+      m_userspace(false),
+      m_euid(0),
+      m_egid(0),
+      m_dacOverride(false),
+      m_dacReadSearch(false),
+      m_allIdsMapped(false),
+      m_checks(0),
+      m_kernelChecks(0) {
+}
+
+void AccessChecker::loadCredentials() {
+    m_loaded = true;
+
+#ifdef __linux__
+    m_euid = geteuid();
+    m_egid = getegid();
+
+    int count = getgroups(0, nullptr);
+    if (count < 0) {
+        return;
+    }
+    m_groups.resize(static_cast<size_t>(count));
+    if (count > 0) {
+        count = getgroups(count, m_groups.data());
+        if (count < 0) {
+            return;
+        }
+        m_groups.resize(static_cast<size_t>(count));
+    }
+
+    struct __user_cap_header_struct header;
+    struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3];
+    header.version = _LINUX_CAPABILITY_VERSION_3;
+    header.pid = 0;
+    if (syscall(SYS_capget, &header, data) != 0) {
+        return;
+    }
+    m_dacOverride = (data[0].effective & (1u << CAP_DAC_OVERRIDE)) != 0;
+    m_dacReadSearch = (data[0].effective & (1u << CAP_DAC_READ_SEARCH)) != 0;
+    m_allIdsMapped = isIdentityMap("/proc/self/uid_map") &&
+                     isIdentityMap("/proc/self/gid_map");
+
+    m_userspace = true;
+#endif
+}
+
+bool AccessChecker::inGroup(gid_t gid) const {
+    if (gid == m_egid) {
+        return true;
+    }
+    for (gid_t group : m_groups) {
+        if (group == gid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FileAccess AccessChecker::check(int dirfd, const char* path, const FileStat& st) {
+    m_checks++;
+    FileAccess access;
+
+#ifdef __linux__
+    if (!m_loaded) {
+        loadCredentials();
+    }
+
+    MountFlags mount;
+    if (m_userspace && lookupMount(dirfd, path, st, mount) && !mount.delegated) {
+        enum Answer { Denied, Granted, Unknown };
+
+        const unsigned modes[3] = { R_OK, W_OK, X_OK };
+        const unsigned bits[3] = { 4, 2, 1 };
+        Answer answers[3];
+        bool aclMatters[3];
+
+        const bool owner = (st.uid == m_euid);
+        const bool group = !owner && inGroup(st.gid);
+        const unsigned classBits = owner ? (st.mode >> 6) & 7
+                                 : group ? (st.mode >> 3) & 7
+                                         : st.mode & 7;
+        const unsigned groupBits = (st.mode >> 3) & 7;
+        const unsigned otherBits = st.mode & 7;
+        const bool unmapped = !m_allIdsMapped &&
+                              (st.uid == OVERFLOW_ID || st.gid == OVERFLOW_ID);
+        bool needAcl = false;
+
+        for (int i = 0; i < 3; ++i) {
+            const unsigned bit = bits[i];
+
+            bool capability;
+            if (S_ISDIR(st.mode)) {
+                capability = m_dacOverride || (bit != 2 && m_dacReadSearch);
+            } else {
+                capability = (m_dacOverride && (bit != 1 || (st.mode & 0111) != 0)) ||
+                             (bit == 4 && m_dacReadSearch);
+            }
+
+            aclMatters[i] = false;
+            if (capability && !unmapped) {
+                answers[i] = Granted;
+                continue;
+            }
+
+            // With an ACL the group bits are its mask: a named entry can
+            // grant a permission only if the mask has it, and can deny one
+            // the group or other bits grant
+            aclMatters[i] = !owner && ((groupBits & bit) != 0 ||
+                                       (!group && (otherBits & bit) != 0));
+            needAcl = needAcl || aclMatters[i];
+
+            if (classBits & bit) {
+                answers[i] = Granted;
+            } else {
+                answers[i] = capability ? Unknown : Denied;
+            }
+        }
+
+        if (needAcl && hasAccessAcl(dirfd, path) != 0) {
+            for (int i = 0; i < 3; ++i) {
+                if (aclMatters[i]) {
+                    answers[i] = Unknown;
+                }
+            }
+        }
+
+        // Mount and inode flags checked by faccessat() before the mode bits
+        if (mount.readOnly && (S_ISREG(st.mode) || S_ISDIR(st.mode) || S_ISLNK(st.mode))) {
+            answers[1] = Denied;
+        } else if (answers[1] == Granted && (st.immutable || !st.immutableKnown)) {
+            answers[1] = st.immutable ? Denied : Unknown;
+        }
+        if (mount.noExec && S_ISREG(st.mode)) {
+            answers[2] = Denied;
+        }
+
+        bool* results[3] = { &access.readable, &access.writable, &access.executable };
+        for (int i = 0; i < 3; ++i) {
+            *results[i] = (answers[i] == Unknown) ? kernelCheck(dirfd, path, modes[i])
+                                                  : (answers[i] == Granted);
+        }
+        return access;
+    }
+#endif
+
+    access.readable = kernelCheck(dirfd, path, R_OK);
+    access.writable = kernelCheck(dirfd, path, W_OK);
+    access.executable = kernelCheck(dirfd, path, X_OK);
+    return access;
+}
+
+bool AccessChecker::lookupMount(int dirfd, const char* path, const FileStat& st,
+                                MountFlags& flags) {
+#ifdef HAVE_STATX
+    if (!st.hasMountId) {
+        return false;
+    }
+
+    const int64_t now = monotonicSeconds();
+    auto it = m_mounts.find(st.mountId);
+    if (it != m_mounts.end() && it->second.expires > now) {
+        flags = it->second;
+        return true;
+    }
+
+    int fd = openat(dirfd, path, O_PATH | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    // The path may have been replaced since it was stat'ed; only cache
+    // flags for the mount the caller asked about
+    struct statx buf;
+    struct statfs fs;
+    bool ok = statx(fd, "", AT_EMPTY_PATH, STATX_MNT_ID, &buf) == 0 &&
+              (buf.stx_mask & STATX_MNT_ID) != 0 && buf.stx_mnt_id == st.mountId &&
+              fstatfs(fd, &fs) == 0;
+    close(fd);
+    if (!ok) {
+        return false;
+    }
+
+    flags.readOnly = (fs.f_flags & ST_RDONLY) != 0;
+    flags.noExec = (fs.f_flags & ST_NOEXEC) != 0;
+    flags.delegated = isDelegatedFilesystem(static_cast<uint32_t>(fs.f_type));
+    flags.expires = now + MOUNT_FLAGS_TTL;
+
+    if (m_mounts.size() >= MAX_MOUNTS) {
+        m_mounts.clear();
+    }
+    m_mounts[st.mountId] = flags;
+    return true;
+#else
+    (void)dirfd;
+    (void)path;
+    (void)st;
+    (void)flags;
+    return false;
+#endif
+}
+
+bool AccessChecker::kernelCheck(int dirfd, const char* path, int mode) {
+    m_kernelChecks++;
+#ifdef __linux__
+    return faccessat(dirfd, path, mode, AT_EACCESS) == 0;
+#else
+    // Real IDs, as access() has always been used here
+    return faccessat(dirfd, path, mode, 0) == 0;
+#endif
+}
+
+} // namespace AixMetadata
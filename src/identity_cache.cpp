@@ -0,0 +1,218 @@
+/**
+ * @file identity_cache.cpp
+ * @brief Implementation of the shared UID/GID name cache
+ *
+ * The resolver is called without holding the cache lock, so one slow
+ * LDAP/NIS lookup does not block lookups of other IDs. Two threads that
+ * miss on the same ID at the same time may both resolve it; the second
+ * answer simply overwrites the first.
+ */
+
+#include "identity_cache.h"
+
+#include <cerrno>
+#include <vector>
+#include <pwd.h>
+#include <grp.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace AixMetadata {
+
+namespace {
+
+// Default lifetimes of cached answers
+const int DEFAULT_POSITIVE_TTL = 300;
+const int DEFAULT_NEGATIVE_TTL = 60;
+
+// Upper bound for the getpwuid_r/getgrgid_r scratch buffer
+const size_t MAX_RESOLVER_BUFFER = 1024 * 1024;
+
+int64_t monotonicSeconds() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return static_cast<int64_t>(time(nullptr));
+    }
+    return static_cast<int64_t>(ts.tv_sec);
+}
+
+size_t initialBufferSize(int sysconfName) {
+    long size = sysconf(sysconfName);
+    return (size > 0) ? static_cast<size_t>(size) : 1024;
+}
+
+/**
+ * @brief Per-thread scratch buffer for getpwuid_r/getgrgid_r
+ *
+ * Kept across lookups so a thread only allocates it once (or again after
+ * an ERANGE retry grew it).
+ */
+std::vector<char>& resolverBuffer(int sysconfName) {
+    static thread_local std::vector<char> buffer;
+    size_t minimum = initialBufferSize(sysconfName);
+    if (buffer.size() < minimum) {
+        buffer.resize(minimum);
+    }
+    return buffer;
+}
+
+/**
+ * @brief Resolve a UID with getpwuid_r, growing the buffer on ERANGE
+ * @return 0 on success (found may be false), or an errno value
+ */
+int resolveUser(uid_t uid, bool& found, std::string& name, gid_t& primaryGid) {
+    std::vector<char>& buffer = resolverBuffer(_SC_GETPW_R_SIZE_MAX);
+
+    for (;;) {
+        struct passwd pwd;
+        struct passwd* result = nullptr;
+        int rc = getpwuid_r(uid, &pwd, &buffer[0], buffer.size(), &result);
+
+        if (rc == ERANGE && buffer.size() < MAX_RESOLVER_BUFFER) {
+            buffer.resize(buffer.size() * 2);
+            continue;
+        }
+        if (rc != 0) {
+            return rc;
+        }
+
+        found = (result != nullptr);
+        if (found) {
+            name = pwd.pw_name;
+            primaryGid = pwd.pw_gid;
+        }
+        return 0;
+    }
+}
+
+/**
+ * @brief Resolve a GID with getgrgid_r, growing the buffer on ERANGE
+ * @return 0 on success (found may be false), or an errno value
+ */
+int resolveGroup(gid_t gid, bool& found, std::string& name) {
+    std::vector<char>& buffer = resolverBuffer(_SC_GETGR_R_SIZE_MAX);
+
+    for (;;) {
+        struct group grp;
+        struct group* result = nullptr;
+        int rc = getgrgid_r(gid, &grp, &buffer[0], buffer.size(), &result);
+
+        if (rc == ERANGE && buffer.size() < MAX_RESOLVER_BUFFER) {
+            buffer.resize(buffer.size() * 2);
+            continue;
+        }
+        if (rc != 0) {
+            return rc;
+        }
+
+        found = (result != nullptr);
+        if (found) {
+            name = grp.gr_name;
+        }
+        return 0;
+    }
+}
+
+} // anonymous namespace
+
+IdentityCache& IdentityCache::instance() {
+    static IdentityCache cache;
+    return cache;
+}
+
+IdentityCache::IdentityCache()
+    : m_positiveTtl(DEFAULT_POSITIVE_TTL),
+      m_negativeTtl(DEFAULT_NEGATIVE_TTL) {
+}
+
+template <typename Map, typename Key>
+bool IdentityCache::findValid(Map& map, Key key, Entry& entry) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    typename Map::const_iterator it = map.find(key);
+    if (it == map.end() || it->second.expires <= monotonicSeconds()) {
+        m_stats.misses++;
+        return false;
+    }
+
+    if (it->second.found) {
+        m_stats.hits++;
+    } else {
+        m_stats.negativeHits++;
+    }
+    entry = it->second;
+    return true;
+}
+
+template <typename Map, typename Key>
+void IdentityCache::store(Map& map, Key key, Entry& entry) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    entry.expires = monotonicSeconds() + (entry.found ? m_positiveTtl : m_negativeTtl);
+    map[key] = entry;
+}
+
+bool IdentityCache::lookupUser(uid_t uid, std::string& name, gid_t* primaryGid) {
+    Entry entry;
+
+    if (!findValid(m_users, uid, entry)) {
+        entry.primaryGid = static_cast<gid_t>(-1);
+        if (resolveUser(uid, entry.found, entry.name, entry.primaryGid) != 0) {
+            // Transient resolver failure; do not cache
+            return false;
+        }
+        store(m_users, uid, entry);
+    }
+
+    if (!entry.found) {
+        return false;
+    }
+
+    name = entry.name;
+    if (primaryGid != nullptr) {
+        *primaryGid = entry.primaryGid;
+    }
+    return true;
+}
+
+bool IdentityCache::lookupGroup(gid_t gid, std::string& name) {
+    Entry entry;
+
+    if (!findValid(m_groups, gid, entry)) {
+        entry.primaryGid = static_cast<gid_t>(-1);
+        if (resolveGroup(gid, entry.found, entry.name) != 0) {
+            // Transient resolver failure; do not cache
+            return false;
+        }
+        store(m_groups, gid, entry);
+    }
+
+    if (!entry.found) {
+        return false;
+    }
+
+    name = entry.name;
+    return true;
+}
+
+void IdentityCache::setTtl(int positiveSeconds, int negativeSeconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_positiveTtl = positiveSeconds;
+    m_negativeTtl = negativeSeconds;
+}
+
+void IdentityCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_users.clear();
+    m_groups.clear();
+}
+
+IdentityCacheStats IdentityCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    IdentityCacheStats stats = m_stats;
+    stats.users = m_users.size();
+    stats.groups = m_groups.size();
+    return stats;
+}
+
+} // namespace AixMetadata
@@ -0,0 +1,410 @@
+/**
+ * @file io_engine.cpp
+ * @brief Implementation of batched file system calls
+ *
+ * The io_uring is driven with the raw system calls (no liburing): the
+ * submission and completion rings are mapped once, a batch fills up to
+ * getDepth() submission entries and a single io_uring_enter() submits
+ * them all and waits for all of them. Each entry's user_data is the
+ * operation's index in the batch. The completion ring has twice the
+ * entries of the submission ring, so a batch never overflows it.
+ */
+
+#include "io_engine.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// io_uring needs 5.6 headers (statx, openat, read and close operations)
+// and a C library with statx(), whose answers file_stat converts
+#if defined(__linux__) && defined(STATX_BASIC_STATS) && defined(__NR_io_uring_setup)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#ifdef IO_URING_OP_SUPPORTED
+#define HAVE_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace AixMetadata {
+
+namespace {
+
+std::atomic<int> g_mode(static_cast<int>(IoEngine::Mode::Auto));
+
+} // anonymous namespace
+
+#ifdef HAVE_IO_URING
+
+struct IoEngine::Ring {
+    int fd;
+    void* sqMap;
+    size_t sqMapSize;
+    void* cqMap;                    ///< Same as sqMap with IORING_FEAT_SINGLE_MMAP
+    size_t cqMapSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    struct io_uring_cqe* cqes;
+
+    std::vector<struct statx> statxBuffers;  ///< One per submission entry
+
+    Ring() : fd(-1), sqMap(MAP_FAILED), sqMapSize(0), cqMap(MAP_FAILED), cqMapSize(0),
+             sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED)), sqesSize(0) {}
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqMap != MAP_FAILED && cqMap != sqMap) {
+            munmap(cqMap, cqMapSize);
+        }
+        if (sqMap != MAP_FAILED) {
+            munmap(sqMap, sqMapSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    /**
+     * @brief Create and map a ring
+     * @return false if io_uring or one of the operations is unavailable
+     */
+    bool setup(unsigned depth);
+
+    /**
+     * @brief Whether the kernel supports every operation the engine uses
+     */
+    bool probe();
+};
+
+namespace {
+
+template <typename T>
+T* ringField(void* map, unsigned offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(map) + offset);
+}
+
+int ringEnter(int fd, unsigned toSubmit, unsigned minComplete) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete,
+                                    IORING_ENTER_GETEVENTS, nullptr, 0));
+}
+
+} // anonymous namespace
+
+bool IoEngine::Ring::setup(unsigned depth) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+    if (fd < 0) {
+        return false;
+    }
+    if (!probe()) {
+        return false;
+    }
+
+    sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        sqMapSize = cqMapSize = (sqMapSize > cqMapSize) ? sqMapSize : cqMapSize;
+    }
+
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 fd, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED) {
+        return false;
+    }
+    if (single) {
+        cqMap = sqMap;
+    } else {
+        cqMap = mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED) {
+            return false;
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = static_cast<struct io_uring_sqe*>(
+        mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+             fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+
+    sqTail = ringField<unsigned>(sqMap, params.sq_off.tail);
+    sqMask = *ringField<unsigned>(sqMap, params.sq_off.ring_mask);
+    sqArray = ringField<unsigned>(sqMap, params.sq_off.array);
+    cqHead = ringField<unsigned>(cqMap, params.cq_off.head);
+    cqTail = ringField<unsigned>(cqMap, params.cq_off.tail);
+    cqMask = *ringField<unsigned>(cqMap, params.cq_off.ring_mask);
+    cqes = ringField<struct io_uring_cqe>(cqMap, params.cq_off.cqes);
+
+    statxBuffers.resize(params.sq_entries);
+    return params.sq_entries >= depth;
+}
+
+bool IoEngine::Ring::probe() {
+    const unsigned OPS = 256;
+    std::vector<char> buffer(sizeof(struct io_uring_probe) +
+                             OPS * sizeof(struct io_uring_probe_op), 0);
+    struct io_uring_probe* ops = reinterpret_cast<struct io_uring_probe*>(buffer.data());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, ops, OPS) < 0) {
+        return false;
+    }
+
+    const unsigned needed[] = { IORING_OP_STATX, IORING_OP_OPENAT,
+                                IORING_OP_READ, IORING_OP_CLOSE };
+    for (unsigned op : needed) {
+        if (op > ops->last_op || !(ops->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#else
+
+struct IoEngine::Ring {};
+
+#endif // HAVE_IO_URING
+
+IoEngine::IoEngine(unsigned depth)
+    : m_depth(depth == 0 ? 1 : depth),
+      m_tried(false),
+      m_operations(0),
+      m_submits(0) {
+}
+
+IoEngine::~IoEngine() {
+    submit();
+}
+
+void IoEngine::setMode(Mode mode) {
+    g_mode.store(static_cast<int>(mode));
+}
+
+bool IoEngine::isAsync() {
+    if (!m_tried) {
+        m_tried = true;
+#ifdef HAVE_IO_URING
+        const Mode mode = static_cast<Mode>(g_mode.load());
+        if (mode == Mode::Direct ||
+            (mode == Mode::Auto && sysconf(_SC_NPROCESSORS_ONLN) < 2)) {
+            return false;
+        }
+
+        std::unique_ptr<Ring> ring(new Ring());
+        if (ring->setup(m_depth)) {
+            m_ring = std::move(ring);
+            m_queue.reserve(m_depth);
+        }
+#endif
+    }
+    return m_ring != nullptr;
+}
+
+void IoEngine::stat(int dirfd, const char* path, bool followLinks, FileStat& st, int& result) {
+    Operation op = Operation();
+    op.kind = Operation::Stat;
+    op.fd = dirfd;
+    op.path = path;
+    op.flags = followLinks ? 1 : 0;
+    op.st = &st;
+    op.result = &result;
+    enqueue(op);
+}
+
+void IoEngine::open(int dirfd, const char* path, int flags, int& result) {
+    Operation op = Operation();
+    op.kind = Operation::Open;
+    op.fd = dirfd;
+    op.path = path;
+    op.flags = flags | O_CLOEXEC;
+    op.result = &result;
+    enqueue(op);
+}
+
+void IoEngine::read(int fd, void* buffer, size_t length, uint64_t offset, int& result) {
+    Operation op = Operation();
+    op.kind = Operation::Read;
+    op.fd = fd;
+    op.buffer = buffer;
+    op.length = length;
+    op.offset = offset;
+    op.result = &result;
+    enqueue(op);
+}
+
+void IoEngine::close(int fd) {
+    Operation op = Operation();
+    op.kind = Operation::Close;
+    op.fd = fd;
+    enqueue(op);
+}
+
+void IoEngine::enqueue(const Operation& op) {
+    m_operations++;
+    if (!isAsync()) {
+        runDirect(op);
+        return;
+    }
+
+    m_queue.push_back(op);
+    if (m_queue.size() >= m_depth) {
+        submit();
+    }
+}
+
+void IoEngine::runDirect(const Operation& op) {
+    int result = 0;
+    switch (op.kind) {
+    case Operation::Stat:
+        result = statFile(op.fd, op.path, op.flags != 0, *op.st) ? 0 : -errno;
+        break;
+    case Operation::Open:
+        result = ::openat(op.fd, op.path, op.flags);
+        if (result < 0) {
+            result = -errno;
+        }
+        break;
+    case Operation::Read: {
+        ssize_t bytes = ::pread(op.fd, op.buffer, op.length, static_cast<off_t>(op.offset));
+        result = bytes < 0 ? -errno : static_cast<int>(bytes);
+        break;
+    }
+    case Operation::Close:
+        ::close(op.fd);
+        break;
+    }
+
+    if (op.result != nullptr) {
+        *op.result = result;
+    }
+}
+
+void IoEngine::submit() {
+    if (m_queue.empty()) {
+        return;
+    }
+
+    // A lone call is cheaper made directly than through the ring
+    if (m_queue.size() == 1) {
+        runDirect(m_queue[0]);
+        m_queue.clear();
+        return;
+    }
+
+#ifdef HAVE_IO_URING
+    Ring& ring = *m_ring;
+    const unsigned count = static_cast<unsigned>(m_queue.size());
+    m_submits++;
+
+    // Only this thread writes the submission tail
+    unsigned tail = *ring.sqTail;
+    for (unsigned i = 0; i < count; i++) {
+        const Operation& op = m_queue[i];
+        const unsigned index = tail & ring.sqMask;
+        struct io_uring_sqe& sqe = ring.sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.fd = op.fd;
+        sqe.user_data = i;
+
+        switch (op.kind) {
+        case Operation::Stat:
+            sqe.opcode = IORING_OP_STATX;
+            sqe.addr = reinterpret_cast<uint64_t>(op.path);
+            sqe.len = statxFileMask();
+            sqe.addr2 = reinterpret_cast<uint64_t>(&ring.statxBuffers[i]);
+            // stat() never automounts the last component; match it
+            sqe.statx_flags = AT_NO_AUTOMOUNT | (op.flags ? 0 : AT_SYMLINK_NOFOLLOW);
+            break;
+        case Operation::Open:
+            sqe.opcode = IORING_OP_OPENAT;
+            sqe.addr = reinterpret_cast<uint64_t>(op.path);
+            sqe.open_flags = static_cast<uint32_t>(op.flags);
+            break;
+        case Operation::Read:
+            sqe.opcode = IORING_OP_READ;
+            sqe.addr = reinterpret_cast<uint64_t>(op.buffer);
+            sqe.len = static_cast<uint32_t>(op.length);
+            sqe.off = op.offset;
+            break;
+        case Operation::Close:
+            sqe.opcode = IORING_OP_CLOSE;
+            break;
+        }
+
+        ring.sqArray[index] = index;
+        tail++;
+    }
+    __atomic_store_n(ring.sqTail, tail, __ATOMIC_RELEASE);
+
+    unsigned submitted = 0;
+    unsigned completed = 0;
+    bool failed = false;
+    while (completed < count) {
+        // A partial submission returns without waiting, so asking for
+        // every outstanding completion cannot wait on unsubmitted entries
+        if (!failed || completed < submitted) {
+            int ret = ringEnter(ring.fd, failed ? 0 : count - submitted,
+                                (failed ? submitted : count) - completed);
+            if (ret < 0 && errno != EINTR) {
+                failed = true;
+            } else if (ret > 0 && !failed) {
+                submitted += static_cast<unsigned>(ret);
+            }
+        }
+
+        unsigned head = *ring.cqHead;
+        const unsigned cqTail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+        for (; head != cqTail; head++) {
+            const struct io_uring_cqe& cqe = ring.cqes[head & ring.cqMask];
+            const size_t i = static_cast<size_t>(cqe.user_data);
+            const Operation& op = m_queue[i];
+            if (op.kind == Operation::Stat && cqe.res == 0) {
+                fileStatFromStatx(ring.statxBuffers[i], *op.st);
+            }
+            if (op.result != nullptr) {
+                *op.result = cqe.res;
+            }
+            completed++;
+        }
+        __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+
+        if (failed && completed == submitted) {
+            break;
+        }
+    }
+
+    if (failed) {
+        // io_uring_enter() itself failed (e.g. ENOMEM): give up on the
+        // ring and make the calls it did not take directly
+        for (unsigned i = submitted; i < count; i++) {
+            runDirect(m_queue[i]);
+        }
+        m_ring.reset();
+    }
+#endif
+
+    m_queue.clear();
+}
+
+} // namespace AixMetadata
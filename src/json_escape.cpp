@@ -0,0 +1,183 @@
+/**
+ * @file json_escape.cpp
+ * @brief Implementation of the JSON escape scanners
+ *
+ * The x86 vector paths are only compiled with GCC-compatible compilers;
+ * AVX2 code is built with a per-function target attribute so the rest of
+ * the program does not require an AVX2 CPU.
+ */
+
+#include "json_escape.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define AIX_METADATA_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace AixMetadata {
+
+namespace {
+
+inline bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+/**
+ * @brief Byte-at-a-time scan of a short tail
+ */
+size_t scanBytes(const char* data, size_t pos, size_t size) {
+    while (pos < size && !needsEscape(static_cast<unsigned char>(data[pos]))) {
+        ++pos;
+    }
+    return pos;
+}
+
+/**
+ * @brief Portable scan, testing 8 bytes per step with word arithmetic
+ *
+ * A word is skipped when none of its bytes is below 0x20 or equal to
+ * '"' or '\\'; otherwise its bytes are checked one by one.
+ */
+size_t findEscapeSwar(const char* data, size_t size) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t quotes = ones * '"';
+    const uint64_t slashes = ones * '\\';
+
+    size_t pos = 0;
+    for (; pos + 8 <= size; pos += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + pos, sizeof(word));
+
+        // Per-byte flags: any byte < 0x20, or equal to '"' / '\\'
+        uint64_t below = (word - ones * 0x20) & ~word;
+        uint64_t quote = ((word ^ quotes) - ones) & ~(word ^ quotes);
+        uint64_t slash = ((word ^ slashes) - ones) & ~(word ^ slashes);
+
+        if ((below | quote | slash) & highs) {
+            return scanBytes(data, pos, pos + 8);
+        }
+    }
+    return scanBytes(data, pos, size);
+}
+
+#ifdef AIX_METADATA_X86_SIMD
+
+/**
+ * @brief SSE2 scan, 16 bytes per step
+ */
+__attribute__((target("sse2")))
+size_t findEscapeSse2(const char* data, size_t size) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+
+    size_t pos = 0;
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+
+        // Unsigned c <= 0x1f  <=>  max(c, 0x1f) == 0x1f
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, slash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+    return scanBytes(data, pos, size);
+}
+
+/**
+ * @brief AVX2 scan, 32 bytes per step
+ */
+__attribute__((target("avx2")))
+size_t findEscapeAvx2(const char* data, size_t size) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i slash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+
+    size_t pos = 0;
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+
+        __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, slash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control));
+
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return pos + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+    return pos + findEscapeSse2(data + pos, size - pos);
+}
+
+#endif // AIX_METADATA_X86_SIMD
+
+typedef size_t (*ScanFunction)(const char*, size_t);
+
+struct Backend {
+    ScanFunction scan;
+    const char* name;
+};
+
+Backend selectBackend() {
+#ifdef AIX_METADATA_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        Backend backend = {findEscapeAvx2, "avx2"};
+        return backend;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        Backend backend = {findEscapeSse2, "sse2"};
+        return backend;
+    }
+#endif
+    Backend backend = {findEscapeSwar, "swar"};
+    return backend;
+}
+
+const Backend& backend() {
+    static const Backend selected = selectBackend();
+    return selected;
+}
+
+} // anonymous namespace
+
+size_t findJsonEscape(const char* data, size_t size) {
+    return backend().scan(data, size);
+}
+
+const char* jsonEscapeBackend() {
+    return backend().name;
+}
+
+bool findJsonEscapeWith(const char* backend, const char* data, size_t size, size_t& offset) {
+    if (std::strcmp(backend, "scalar") == 0) {
+        offset = scanBytes(data, 0, size);
+        return true;
+    }
+    if (std::strcmp(backend, "swar") == 0) {
+        offset = findEscapeSwar(data, size);
+        return true;
+    }
+#ifdef AIX_METADATA_X86_SIMD
+    __builtin_cpu_init();
+    if (std::strcmp(backend, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        offset = findEscapeSse2(data, size);
+        return true;
+    }
+    if (std::strcmp(backend, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        offset = findEscapeAvx2(data, size);
+        return true;
+    }
+#endif
+    return false;
+}
+
+} // namespace AixMetadata
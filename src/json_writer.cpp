@@ -0,0 +1,398 @@
+/**
+ * @file json_writer.cpp
+ * @brief Implementation of the streaming JSON writer
+ *
+ * In pretty mode a result nested in an array is indented by one level on
+ * every line, including otherwise empty lines; newline() applies that base
+ * indentation so nested objects never have to be re-indented afterwards.
+ */
+
+#include "json_writer.h"
+#include "json_escape.h"
+
+#include <cstring>
+
+namespace AixMetadata {
+
+namespace {
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+// "00" "01" ... "99": two digits per table lookup when formatting integers
+const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+} // anonymous namespace
+
+JsonWriter::JsonWriter(std::string& out, bool prettyPrint, bool stringValues)
+    : m_out(out), m_pretty(prettyPrint), m_stringValues(stringValues), m_baseIndent(0) {
+}
+
+void JsonWriter::writeResult(const MetadataResult& result) {
+    m_out += '{';
+    newline();
+
+    // success field
+    indent(1);
+    key("success");
+    m_out += result.success ? "true" : "false";
+    m_out += ',';
+    newline();
+
+    // type field
+    indent(1);
+    key("type");
+    stringValue(result.type);
+    m_out += ',';
+    newline();
+
+    // identifier field
+    indent(1);
+    key("identifier");
+    stringValue(result.identifier);
+    m_out += ',';
+    newline();
+
+    // error message (if any)
+    if (!result.success && !result.errorMessage.empty()) {
+        indent(1);
+        key("error");
+        stringValue(result.errorMessage);
+        m_out += ',';
+        newline();
+    }
+
+    // attributes
+    indent(1);
+    key("attributes");
+    m_out += '{';
+    newline();
+
+    bool firstAttr = true;
+    for (const auto& attr : result.attributes) {
+        if (!firstAttr) {
+            m_out += ',';
+            newline();
+        }
+        firstAttr = false;
+
+        attribute(attr, 2);
+    }
+
+    newline();
+    indent(1);
+    m_out += '}';
+    newline();
+    m_out += '}';
+}
+
+void JsonWriter::writeArray(const std::vector<MetadataResult>& results) {
+    m_out += '[';
+    m_baseIndent++;
+    newline();
+
+    bool first = true;
+    for (const auto& result : results) {
+        if (!first) {
+            m_out += ',';
+            newline();
+        }
+        first = false;
+
+        writeResult(result);
+    }
+
+    m_baseIndent--;
+
+    newline();
+    m_out += ']';
+}
+
+void JsonWriter::appendEscaped(std::string& out, const std::string& str) {
+    appendEscaped(out, str.data(), str.size());
+}
+
+void JsonWriter::appendEscaped(std::string& out, const char* data, size_t size) {
+    size_t pos = 0;
+
+    for (;;) {
+        // Copy the run of characters that need no escaping in one go
+        size_t runEnd = pos + findJsonEscape(data + pos, size - pos);
+        out.append(data + pos, runEnd - pos);
+        if (runEnd == size) {
+            break;
+        }
+
+        unsigned char c = static_cast<unsigned char>(data[runEnd]);
+        pos = runEnd + 1;
+
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\b':
+                out += "\\b";
+                break;
+            case '\f':
+                out += "\\f";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default: {
+                // Other control characters
+                char unicode[6] = {'\\', 'u', '0', '0',
+                                   HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0x0f]};
+                out.append(unicode, sizeof(unicode));
+                break;
+            }
+        }
+    }
+}
+
+void JsonWriter::appendInteger(std::string& out, uint64_t value) {
+    // Fill from the end; 20 digits hold any 64-bit value
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+
+    while (value >= 100) {
+        unsigned pair = static_cast<unsigned>(value % 100) * 2;
+        value /= 100;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    }
+    if (value >= 10) {
+        unsigned pair = static_cast<unsigned>(value) * 2;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    } else {
+        *--p = static_cast<char>('0' + value);
+    }
+
+    out.append(p, static_cast<size_t>(end - p));
+}
+
+void JsonWriter::appendInteger(std::string& out, int64_t value) {
+    if (value < 0) {
+        out += '-';
+        // Negate in unsigned arithmetic so INT64_MIN does not overflow
+        appendInteger(out, 0 - static_cast<uint64_t>(value));
+    } else {
+        appendInteger(out, static_cast<uint64_t>(value));
+    }
+}
+
+void JsonWriter::newline() {
+    if (m_pretty) {
+        m_out += '\n';
+        m_out.append(static_cast<size_t>(m_baseIndent) * 2, ' ');
+    }
+}
+
+void JsonWriter::indent(int level) {
+    if (m_pretty) {
+        m_out.append(static_cast<size_t>(level) * 2, ' ');
+    }
+}
+
+void JsonWriter::key(const char* name) {
+    m_out += '"';
+    m_out += name;
+    m_out += "\":";
+    if (m_pretty) {
+        m_out += ' ';
+    }
+}
+
+void JsonWriter::key(const std::string& name) {
+    stringValue(name);
+    m_out += ':';
+    if (m_pretty) {
+        m_out += ' ';
+    }
+}
+
+void JsonWriter::stringValue(const std::string& value) {
+    m_out += '"';
+    appendEscaped(m_out, value);
+    m_out += '"';
+}
+
+void JsonWriter::stringArray(const std::vector<std::string>& values) {
+    m_out += '[';
+
+    bool first = true;
+    for (const auto& value : values) {
+        if (!first) {
+            m_out += ',';
+            if (m_pretty) {
+                m_out += ' ';
+            }
+        }
+        first = false;
+        stringValue(value);
+    }
+
+    m_out += ']';
+}
+
+void JsonWriter::packedList(const std::string& packed, bool joined) {
+    m_out += joined ? '"' : '[';
+
+    const char* data = packed.data();
+    const char* end = data + packed.size();
+    bool first = true;
+    while (data < end) {
+        const char* nul = static_cast<const char*>(std::memchr(data, '\0', end - data));
+        const size_t length = nul ? static_cast<size_t>(nul - data)
+                                  : static_cast<size_t>(end - data);
+        if (joined) {
+            if (!first) {
+                m_out += ' ';
+            }
+            appendEscaped(m_out, data, length);
+        } else {
+            if (!first) {
+                m_out += ',';
+                if (m_pretty) {
+                    m_out += ' ';
+                }
+            }
+            m_out += '"';
+            appendEscaped(m_out, data, length);
+            m_out += '"';
+        }
+        first = false;
+        data += length + 1;
+    }
+
+    m_out += joined ? '"' : ']';
+}
+
+void JsonWriter::object(const std::vector<MetadataAttribute>& fields, int level) {
+    if (fields.empty()) {
+        m_out += "{}";
+        return;
+    }
+
+    m_out += '{';
+    newline();
+
+    bool first = true;
+    for (const auto& field : fields) {
+        if (!first) {
+            m_out += ',';
+            newline();
+        }
+        first = false;
+
+        attribute(field, level + 1);
+    }
+
+    newline();
+    indent(level);
+    m_out += '}';
+}
+
+void JsonWriter::objectArray(const std::vector<MetadataAttribute>& elements, int level) {
+    if (elements.empty()) {
+        m_out += "[]";
+        return;
+    }
+
+    m_out += '[';
+    newline();
+
+    bool first = true;
+    for (const auto& element : elements) {
+        if (!first) {
+            m_out += ',';
+            newline();
+        }
+        first = false;
+
+        indent(level + 1);
+        object(element.children, level + 1);
+    }
+
+    newline();
+    indent(level);
+    m_out += ']';
+}
+
+void JsonWriter::attribute(const MetadataAttribute& attr, int level) {
+    indent(level);
+    key(attr.name);
+
+    const char* quote = m_stringValues ? "\"" : "";
+
+    switch (attr.kind) {
+        case AttributeKind::Int:
+            m_out += quote;
+            appendInteger(m_out, attr.intValue);
+            m_out += quote;
+            break;
+
+        case AttributeKind::UInt:
+            m_out += quote;
+            appendInteger(m_out, attr.uintValue);
+            m_out += quote;
+            break;
+
+        case AttributeKind::Bool:
+            m_out += quote;
+            m_out += attr.boolValue ? "true" : "false";
+            m_out += quote;
+            break;
+
+        case AttributeKind::Object:
+            object(attr.children, level);
+            break;
+
+        case AttributeKind::ObjectList:
+            objectArray(attr.children, level);
+            break;
+
+        case AttributeKind::PackedList:
+            packedList(attr.values.empty() ? std::string() : attr.values[0], m_stringValues);
+            break;
+
+        case AttributeKind::String:
+        case AttributeKind::List:
+        default:
+            if (attr.kind == AttributeKind::List && !m_stringValues) {
+                stringArray(attr.values);
+            } else if (attr.values.size() == 1) {
+                // Single value - output as string
+                stringValue(attr.values[0]);
+            } else if (attr.values.empty()) {
+                // No values - output null
+                m_out += "null";
+            } else {
+                // Multiple values - output as array
+                stringArray(attr.values);
+            }
+            break;
+    }
+}
+
+} // namespace AixMetadata
@@ -6,27 +6,52 @@
  * It provides a unified interface to query metadata for:
  *   - Processes (by PID)
  *   - Files (by path)
- *   - Network ports (by port number)
+ *   - Network ports (by port number, list/range, or every listening socket)
  *
  * Usage:
  *   aix-metadata-collector --process <pid>
- *   aix-metadata-collector --file <path>
- *   aix-metadata-collector --port <port> [--protocol tcp|udp|both]
+ *   aix-metadata-collector --file <path> [--openers]
+ *   aix-metadata-collector --port <port[,port|lo-hi]...> [--protocol tcp|udp|both]
+ *   aix-metadata-collector --listening [--protocol tcp|udp|both]
+ *   aix-metadata-collector --batch <file|-> [--ndjson] [--jobs <n>] [--unordered]
+ *   aix-metadata-collector --all-processes [--ndjson]
+ *   aix-metadata-collector --walk <dir> [--max-depth <n>] [--xdev] [--type <types>]
+ *                          [--perm <props>] [--jobs <n>]
+ *   aix-metadata-collector --daemon <socket-path>
  *   aix-metadata-collector --help
  *   aix-metadata-collector --version
  *
- * Output is in JSON format by default.
+ * Output is in JSON format by default. --process, --file and --port may be
+ * repeated; when more than one query is given (or --batch is used) the
+ * results are emitted as a JSON array, or as NDJSON with --ndjson. With
+ * --jobs the queries run on several worker threads (see BatchExecutor).
+ * --walk streams one NDJSON file result per entry of a directory tree
+ * (see DirectoryWalker). --openers adds the processes holding each file
+ * open (see OpenerScanner).
  */
 
 #include "types.h"
 #include "process_collector.h"
 #include "file_collector.h"
 #include "port_collector.h"
+#include "collector_set.h"
+#include "batch_executor.h"
+#include "directory_walker.h"
+#include "io_engine.h"
+#include "query_server.h"
 #include "json_formatter.h"
+#include "json_writer.h"
+#include "identity_cache.h"
 
 #include <iostream>
+#include <fstream>
+#include <climits>
+#include <cstdint>
 #include <cstring>
 #include <cstdlib>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace {
 
@@ -34,6 +59,12 @@ namespace {
 const char* VERSION = "1.0.0";
 const char* PROGRAM_NAME = "aix-metadata-collector";
 
+// Upper bound for --jobs
+const long MAX_JOBS = 256;
+
+// Per-worker output buffered by --walk before it is written out
+const size_t WALK_OUTPUT_CHUNK = 64 * 1024;
+
 /**
  * @brief Print usage information
  */
@@ -42,29 +73,80 @@ void printUsage() {
               << "\n"
               << "Usage:\n"
               << "  " << PROGRAM_NAME << " --process <pid>\n"
-              << "  " << PROGRAM_NAME << " --file <path>\n"
-              << "  " << PROGRAM_NAME << " --port <port> [--protocol tcp|udp|both]\n"
+              << "  " << PROGRAM_NAME << " --file <path> [--openers]\n"
+              << "  " << PROGRAM_NAME << " --port <port[,port|lo-hi]...> [--protocol tcp|udp|both]\n"
+              << "  " << PROGRAM_NAME << " --listening [--protocol tcp|udp|both]\n"
+              << "  " << PROGRAM_NAME << " --batch <file|-> [--ndjson] [--jobs <n>] [--unordered]\n"
+              << "  " << PROGRAM_NAME << " --all-processes [--ndjson]\n"
+              << "  " << PROGRAM_NAME << " --walk <dir> [--max-depth <n>] [--xdev] [--type <types>]\n"
+              << "        [--perm <props>] [--jobs <n>]\n"
+              << "  " << PROGRAM_NAME << " --daemon <socket-path>\n"
               << "  " << PROGRAM_NAME << " --help\n"
               << "  " << PROGRAM_NAME << " --version\n"
               << "\n"
               << "Options:\n"
               << "  -p, --process <pid>     Collect metadata for a process by PID\n"
               << "  -f, --file <path>       Collect metadata for a file by path\n"
-              << "  -P, --port <port>       Collect metadata for network connections on a port\n"
+              << "  --openers               With file queries, list the processes and fds\n"
+              << "                          holding each file open (scans every process)\n"
+              << "  -P, --port <ports>      Collect metadata for network connections on a port,\n"
+              << "                          or on a list/range of ports (22,80,8000-8100)\n"
+              << "  --listening             Collect every listening TCP and unconnected UDP socket\n"
               << "  --protocol <proto>      Protocol filter for port queries (tcp, udp, or both)\n"
               << "                          Default: both\n"
+              << "  --batch <file|->        Read queries from a file (or stdin with -),\n"
+              << "                          one \"<process|file|port> <identifier>\" per line\n"
+              << "  --jobs <n>              Run queries on n worker threads (0: one per CPU)\n"
+              << "                          Default: 1\n"
+              << "  --unordered             With --jobs, output results as they complete\n"
+              << "                          instead of in input order\n"
+              << "  --all-processes         Collect metadata for every process on the system\n"
+              << "  --walk <dir>            Collect file metadata for every entry below a\n"
+              << "                          directory, streamed as NDJSON (symlinks not followed)\n"
+              << "  --max-depth <n>         With --walk, deepest level reported (dir itself: 0)\n"
+              << "  --xdev                  With --walk, stay on the directory's filesystem\n"
+              << "  --type <types>          With --walk, report only these types: any of\n"
+              << "                          f,d,l,b,c,p,s\n"
+              << "  --perm <props>          With --walk, report only entries with any of:\n"
+              << "                          setuid,setgid,sticky,world-writable\n"
+              << "  --ndjson                Output one compact JSON object per line\n"
+              << "  --daemon <socket-path>  Serve NDJSON queries on a Unix domain socket,\n"
+              << "                          e.g. {\"type\":\"process\",\"id\":\"1234\"}\n"
               << "  --compact               Output compact JSON (no pretty printing)\n"
+              << "  --max-cmdline <bytes>   Report at most this many bytes of each process's\n"
+              << "                          arguments (0: no limit), marking longer command\n"
+              << "                          lines with cmdline_truncated. Default: 1048576\n"
+              << "  --max-open-files <n>    List at most n open files per process (0: no\n"
+              << "                          limit); all are still counted. Default: 4096\n"
+              << "  --io <mode>             Batch bulk-mode file calls through io_uring:\n"
+              << "                          auto (default; with more than one CPU),\n"
+              << "                          io_uring or direct\n"
+              << "  --time-precision <s|ns> Precision of *_time attributes: whole seconds\n"
+              << "                          (default) or nanoseconds\n"
+              << "  --time-offset           Append the UTC offset to *_time attributes\n"
+              << "                          (e.g. 2024-03-05T14:07:09+01:00)\n"
+              << "  --string-values         Output every value as a JSON string, as in\n"
+              << "                          version 1.x (\"pid\": \"1234\")\n"
+              << "  --stats                 Print collector statistics to stderr\n"
               << "  -h, --help              Show this help message\n"
               << "  -v, --version           Show version information\n"
               << "\n"
               << "Examples:\n"
               << "  " << PROGRAM_NAME << " --process 1234\n"
               << "  " << PROGRAM_NAME << " --file /etc/passwd\n"
+              << "  " << PROGRAM_NAME << " --file /var/log/messages --openers\n"
               << "  " << PROGRAM_NAME << " --port 22 --protocol tcp\n"
+              << "  " << PROGRAM_NAME << " --port 22,80,8000-8100\n"
+              << "  " << PROGRAM_NAME << " --listening --protocol tcp\n"
               << "  " << PROGRAM_NAME << " -p 1 --compact\n"
+              << "  " << PROGRAM_NAME << " -p 1 -p 2 -f /etc/passwd --ndjson\n"
+              << "  " << PROGRAM_NAME << " --batch queries.txt\n"
+              << "  " << PROGRAM_NAME << " --batch queries.txt --jobs 8 --ndjson --unordered\n"
+              << "  " << PROGRAM_NAME << " --walk /usr --xdev --perm setuid,setgid --jobs 8\n"
               << "\n"
               << "Output:\n"
               << "  Results are output in JSON format to stdout.\n"
+              << "  Repeated or batched queries produce a JSON array (or NDJSON).\n"
               << "  Errors are output to stderr.\n"
               << "\n"
               << "Notes:\n"
@@ -88,17 +170,35 @@ void printVersion() {
 struct CommandLineArgs {
     enum class Mode {
         None,
-        Process,
-        File,
-        Port,
+        Query,
+        Walk,
+        Daemon,
         Help,
         Version
     };
 
     Mode mode = Mode::None;
-    std::string identifier;
+    std::vector<AixMetadata::QueryRequest> requests;
+    std::string batchFile;
+    std::string socketPath;
+    std::string walkRoot;
+    AixMetadata::WalkOptions walk;
+    bool walkOptionGiven = false;
+    bool allProcesses = false;
     AixMetadata::Protocol protocol = AixMetadata::Protocol::Both;
     bool prettyPrint = true;
+    bool ndjson = false;
+    bool stringValues = false;
+    bool showStats = false;
+    AixMetadata::TimestampFormatter::Precision timePrecision =
+        AixMetadata::TimestampFormatter::Precision::Seconds;
+    bool timeOffset = false;
+    AixMetadata::IoEngine::Mode ioMode = AixMetadata::IoEngine::Mode::Auto;
+    size_t commandLineLimit = AixMetadata::ProcessCollector::DEFAULT_COMMAND_LINE_LIMIT;
+    size_t openFileLimit = AixMetadata::ProcessCollector::DEFAULT_OPEN_FILE_LIMIT;
+    bool findOpeners = false;
+    size_t jobs = 1;
+    bool unordered = false;
     bool valid = true;
     std::string errorMessage;
 };
@@ -130,8 +230,8 @@ CommandLineArgs parseArgs(int argc, char* argv[]) {
                 args.errorMessage = "Missing PID argument for --process";
                 return args;
             }
-            args.mode = CommandLineArgs::Mode::Process;
-            args.identifier = argv[++i];
+            args.mode = CommandLineArgs::Mode::Query;
+            args.requests.emplace_back(AixMetadata::QueryType::Process, argv[++i]);
             continue;
         }
 
@@ -141,8 +241,8 @@ CommandLineArgs parseArgs(int argc, char* argv[]) {
                 args.errorMessage = "Missing path argument for --file";
                 return args;
             }
-            args.mode = CommandLineArgs::Mode::File;
-            args.identifier = argv[++i];
+            args.mode = CommandLineArgs::Mode::Query;
+            args.requests.emplace_back(AixMetadata::QueryType::File, argv[++i]);
             continue;
         }
 
@@ -152,8 +252,100 @@ CommandLineArgs parseArgs(int argc, char* argv[]) {
                 args.errorMessage = "Missing port argument for --port";
                 return args;
             }
-            args.mode = CommandLineArgs::Mode::Port;
-            args.identifier = argv[++i];
+            args.mode = CommandLineArgs::Mode::Query;
+            args.requests.emplace_back(AixMetadata::QueryType::Port, argv[++i]);
+            continue;
+        }
+
+        if (strcmp(arg, "--listening") == 0) {
+            args.mode = CommandLineArgs::Mode::Query;
+            args.requests.emplace_back(AixMetadata::QueryType::Port,
+                                       AixMetadata::PortCollector::LISTENING_IDENTIFIER);
+            continue;
+        }
+
+        if (strcmp(arg, "--batch") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing file argument for --batch";
+                return args;
+            }
+            args.mode = CommandLineArgs::Mode::Query;
+            args.batchFile = argv[++i];
+            continue;
+        }
+
+        if (strcmp(arg, "--all-processes") == 0) {
+            args.mode = CommandLineArgs::Mode::Query;
+            args.allProcesses = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--walk") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing directory argument for --walk";
+                return args;
+            }
+            args.mode = CommandLineArgs::Mode::Walk;
+            args.walkRoot = argv[++i];
+            continue;
+        }
+
+        if (strcmp(arg, "--max-depth") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing depth argument for --max-depth";
+                return args;
+            }
+            const char* depth = argv[++i];
+            char* endPtr = nullptr;
+            long value = std::strtol(depth, &endPtr, 10);
+            if (endPtr == depth || *endPtr != '\0' || value < 0 || value > INT_MAX) {
+                args.valid = false;
+                args.errorMessage = std::string("Invalid depth: ") + depth;
+                return args;
+            }
+            args.walk.maxDepth = static_cast<int>(value);
+            args.walkOptionGiven = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--xdev") == 0) {
+            args.walk.sameFilesystem = true;
+            args.walkOptionGiven = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--type") == 0 || strcmp(arg, "--perm") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = std::string("Missing argument for ") + arg;
+                return args;
+            }
+            bool ok = (arg[2] == 't')
+                ? AixMetadata::WalkOptions::parseTypes(argv[i + 1], args.walk.typeMask,
+                                                       args.errorMessage)
+                : AixMetadata::WalkOptions::parsePermissions(argv[i + 1],
+                                                             args.walk.permissionMask,
+                                                             args.errorMessage);
+            if (!ok) {
+                args.valid = false;
+                return args;
+            }
+            i++;
+            args.walkOptionGiven = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--daemon") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing socket path argument for --daemon";
+                return args;
+            }
+            args.mode = CommandLineArgs::Mode::Daemon;
+            args.socketPath = argv[++i];
             continue;
         }
 
@@ -183,6 +375,133 @@ CommandLineArgs parseArgs(int argc, char* argv[]) {
             continue;
         }
 
+        if (strcmp(arg, "--ndjson") == 0) {
+            args.ndjson = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--string-values") == 0) {
+            args.stringValues = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--openers") == 0) {
+            args.findOpeners = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--stats") == 0) {
+            args.showStats = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--max-cmdline") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing byte count for --max-cmdline";
+                return args;
+            }
+            const char* bytes = argv[++i];
+            char* endPtr = nullptr;
+            unsigned long long value = std::strtoull(bytes, &endPtr, 10);
+            if (endPtr == bytes || *endPtr != '\0' || bytes[0] == '-' ||
+                value > static_cast<unsigned long long>(SIZE_MAX / 2)) {
+                args.valid = false;
+                args.errorMessage = std::string("Invalid byte count: ") + bytes;
+                return args;
+            }
+            args.commandLineLimit = static_cast<size_t>(value);
+            continue;
+        }
+
+        if (strcmp(arg, "--max-open-files") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing count for --max-open-files";
+                return args;
+            }
+            const char* count = argv[++i];
+            char* endPtr = nullptr;
+            unsigned long long value = std::strtoull(count, &endPtr, 10);
+            if (endPtr == count || *endPtr != '\0' || count[0] == '-' ||
+                value > static_cast<unsigned long long>(SIZE_MAX / 2)) {
+                args.valid = false;
+                args.errorMessage = std::string("Invalid count: ") + count;
+                return args;
+            }
+            args.openFileLimit = static_cast<size_t>(value);
+            continue;
+        }
+
+        if (strcmp(arg, "--io") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing argument for --io";
+                return args;
+            }
+            const char* mode = argv[++i];
+            if (strcmp(mode, "auto") == 0) {
+                args.ioMode = AixMetadata::IoEngine::Mode::Auto;
+            } else if (strcmp(mode, "io_uring") == 0) {
+                args.ioMode = AixMetadata::IoEngine::Mode::IoUring;
+            } else if (strcmp(mode, "direct") == 0) {
+                args.ioMode = AixMetadata::IoEngine::Mode::Direct;
+            } else {
+                args.valid = false;
+                args.errorMessage = "Invalid I/O mode. Use: auto, io_uring or direct";
+                return args;
+            }
+            continue;
+        }
+
+        if (strcmp(arg, "--time-precision") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing argument for --time-precision";
+                return args;
+            }
+            const char* precision = argv[++i];
+            if (strcmp(precision, "s") == 0) {
+                args.timePrecision = AixMetadata::TimestampFormatter::Precision::Seconds;
+            } else if (strcmp(precision, "ns") == 0) {
+                args.timePrecision = AixMetadata::TimestampFormatter::Precision::Nanoseconds;
+            } else {
+                args.valid = false;
+                args.errorMessage = "Invalid time precision. Use: s or ns";
+                return args;
+            }
+            continue;
+        }
+
+        if (strcmp(arg, "--time-offset") == 0) {
+            args.timeOffset = true;
+            continue;
+        }
+
+        if (strcmp(arg, "--jobs") == 0) {
+            if (i + 1 >= argc) {
+                args.valid = false;
+                args.errorMessage = "Missing count argument for --jobs";
+                return args;
+            }
+            const char* count = argv[++i];
+            char* endPtr = nullptr;
+            long value = std::strtol(count, &endPtr, 10);
+            if (endPtr == count || *endPtr != '\0' || value < 0 || value > MAX_JOBS) {
+                args.valid = false;
+                args.errorMessage = std::string("Invalid job count: ") + count +
+                                    " (expected 0-" + std::to_string(MAX_JOBS) + ")";
+                return args;
+            }
+            args.jobs = static_cast<size_t>(value);
+            continue;
+        }
+
+        if (strcmp(arg, "--unordered") == 0) {
+            args.unordered = true;
+            continue;
+        }
+
         // Unknown argument
         args.valid = false;
         args.errorMessage = std::string("Unknown argument: ") + arg;
@@ -191,12 +510,163 @@ CommandLineArgs parseArgs(int argc, char* argv[]) {
 
     if (args.mode == CommandLineArgs::Mode::None) {
         args.valid = false;
-        args.errorMessage = "No operation specified. Use --process, --file, or --port";
+        args.errorMessage = "No operation specified. Use --process, --file, --port, "
+                            "--listening, --batch, --all-processes, --walk or --daemon";
+    } else if (!args.walkRoot.empty() &&
+               (!args.requests.empty() || !args.batchFile.empty() || args.allProcesses ||
+                !args.socketPath.empty())) {
+        args.valid = false;
+        args.errorMessage = "--walk cannot be combined with other queries";
+    } else if (args.walkOptionGiven && args.walkRoot.empty()) {
+        args.valid = false;
+        args.errorMessage = "--max-depth, --xdev, --type and --perm require --walk";
+    } else if (args.findOpeners && !args.walkRoot.empty()) {
+        // One scan of every process per entry would dwarf the walk itself
+        args.valid = false;
+        args.errorMessage = "--openers cannot be combined with --walk";
+    } else if (!args.socketPath.empty() &&
+               (!args.requests.empty() || !args.batchFile.empty() || args.allProcesses)) {
+        args.valid = false;
+        args.errorMessage = "--daemon cannot be combined with queries";
     }
 
     return args;
 }
 
+/**
+ * @brief Read batch queries, one "<type> <identifier>" per line
+ *
+ * Blank lines and lines starting with '#' are skipped. The identifier is
+ * everything after the first run of whitespace, so file paths may contain
+ * spaces.
+ *
+ * @param in Input stream
+ * @param requests Output: parsed queries are appended
+ * @param errorMessage Output: description of the first malformed line
+ * @return false if a line could not be parsed
+ */
+bool readBatch(std::istream& in,
+               std::vector<AixMetadata::QueryRequest>& requests,
+               std::string& errorMessage) {
+    std::string line;
+    size_t lineNo = 0;
+
+    while (std::getline(in, line)) {
+        lineNo++;
+
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#') {
+            continue;
+        }
+
+        size_t typeEnd = line.find_first_of(" \t", start);
+        size_t idStart = (typeEnd == std::string::npos)
+            ? std::string::npos : line.find_first_not_of(" \t", typeEnd);
+
+        AixMetadata::QueryType type;
+        if (idStart == std::string::npos ||
+            !AixMetadata::parseQueryType(line.substr(start, typeEnd - start), type)) {
+            errorMessage = "Invalid batch line " + std::to_string(lineNo) +
+                           ": expected \"<process|file|port> <identifier>\"";
+            return false;
+        }
+
+        requests.emplace_back(type, line.substr(idStart));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Print collector statistics to stderr, summed over all workers
+ */
+void printStats(AixMetadata::BatchExecutor& executor) {
+    uint64_t processCount = 0;
+    uint64_t kernelFetches = 0;
+    uint64_t accessChecks = 0;
+    uint64_t kernelAccessChecks = 0;
+    uint64_t ioOperations = 0;
+    uint64_t ioSubmits = 0;
+    uint64_t openerScans = 0;
+    uint64_t openerDescriptors = 0;
+    for (size_t i = 0; i < executor.getWorkerCount(); ++i) {
+        const AixMetadata::ProcessCollector& process = executor.getCollectors(i).process();
+        processCount += process.getProcessCount();
+        kernelFetches += process.getKernelFetchCount();
+        ioOperations += process.io().getOperationCount();
+        ioSubmits += process.io().getSubmitCount();
+
+        const AixMetadata::AccessChecker& access =
+            executor.getCollectors(i).file().accessChecker();
+        accessChecks += access.getCheckCount();
+        kernelAccessChecks += access.getKernelCheckCount();
+
+        const AixMetadata::OpenerScanner& openers =
+            executor.getCollectors(i).file().openerScanner();
+        openerScans += openers.getScanCount();
+        openerDescriptors += openers.getDescriptorCount();
+    }
+
+    AixMetadata::IdentityCacheStats identities =
+        AixMetadata::IdentityCache::instance().getStats();
+
+    std::cerr << "Statistics:\n"
+              << "  processes collected:    " << processCount << "\n"
+              << "  process table fetches:  " << kernelFetches << "\n"
+              << "  file access checks:     " << accessChecks
+              << " (" << kernelAccessChecks << " faccessat calls)\n"
+              << "  batched file calls:     " << ioOperations
+              << " (" << ioSubmits << " io_uring batches)\n"
+              << "  opener scans:           " << openerScans
+              << " (" << openerDescriptors << " descriptors checked)\n"
+              << "  worker threads:         " << executor.getWorkerCount()
+              << " (" << executor.getStealCount() << " queries stolen)\n"
+              << "  identity cache hits:    " << identities.hits
+              << " (+" << identities.negativeHits << " negative)\n"
+              << "  identity cache misses:  " << identities.misses << "\n"
+              << std::flush;
+}
+
+/**
+ * @brief Print walk statistics to stderr, summed over all workers
+ */
+void printWalkStats(AixMetadata::DirectoryWalker& walker) {
+    uint64_t accessChecks = 0;
+    uint64_t kernelAccessChecks = 0;
+    uint64_t ioOperations = 0;
+    uint64_t ioSubmits = 0;
+    for (size_t i = 0; i < walker.getWorkerCount(); ++i) {
+        const AixMetadata::AccessChecker& access = walker.getFiles(i).accessChecker();
+        accessChecks += access.getCheckCount();
+        kernelAccessChecks += access.getKernelCheckCount();
+        ioOperations += walker.getFiles(i).io().getOperationCount();
+        ioSubmits += walker.getFiles(i).io().getSubmitCount();
+    }
+
+    AixMetadata::IdentityCacheStats identities =
+        AixMetadata::IdentityCache::instance().getStats();
+
+    std::cerr << "Statistics:\n"
+              << "  entries seen:           " << walker.getEntryCount() << "\n"
+              << "  entries reported:       " << walker.getReportedCount() << "\n"
+              << "  directories read:       " << walker.getDirectoryCount() << "\n"
+              << "  errors:                 " << walker.getErrorCount() << "\n"
+              << "  file access checks:     " << accessChecks
+              << " (" << kernelAccessChecks << " faccessat calls)\n"
+              << "  batched file calls:     " << ioOperations
+              << " (" << ioSubmits << " io_uring batches)\n"
+              << "  worker threads:         " << walker.getWorkerCount()
+              << " (" << walker.getStealCount() << " directories stolen)\n"
+              << "  identity cache hits:    " << identities.hits
+              << " (+" << identities.negativeHits << " negative)\n"
+              << "  identity cache misses:  " << identities.misses << "\n"
+              << std::flush;
+}
+
 } // anonymous namespace
 
 int main(int argc, char* argv[]) {
@@ -221,37 +691,171 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    // Perform the requested operation
-    AixMetadata::MetadataResult result;
+    AixMetadata::IoEngine::setMode(args.ioMode);
+
+    // Serve queries until stopped
+    if (args.mode == CommandLineArgs::Mode::Daemon) {
+        AixMetadata::CollectorSet collectors(args.protocol);
+        collectors.setTimestampFormat(args.timePrecision, args.timeOffset);
+        collectors.setCommandLineLimit(args.commandLineLimit);
+        collectors.setOpenFileLimit(args.openFileLimit);
+        collectors.setFindOpeners(args.findOpeners);
+        AixMetadata::QueryServer server(args.socketPath, collectors, args.protocol);
+        server.setStringValues(args.stringValues);
+
+        std::string errorMessage;
+        if (!server.start(errorMessage)) {
+            std::cerr << "Error: " << errorMessage << std::endl;
+            return 1;
+        }
 
-    switch (args.mode) {
-        case CommandLineArgs::Mode::Process: {
-            AixMetadata::ProcessCollector collector;
-            result = collector.collect(args.identifier);
-            break;
+        return server.run();
+    }
+
+    // Stream the metadata of a whole tree
+    if (args.mode == CommandLineArgs::Mode::Walk) {
+        AixMetadata::FileCollector files;
+        files.timestamps().setPrecision(args.timePrecision);
+        files.timestamps().setOffsetSuffix(args.timeOffset);
+        AixMetadata::DirectoryWalker walker(files, args.jobs, args.walk);
+
+        // Each worker formats into its own buffer and writes it out in
+        // chunks, so workers only contend for the output occasionally
+        std::vector<std::string> buffers(walker.getWorkerCount());
+        std::mutex outputMutex;
+        auto writeOut = [&](std::string& buffer) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::cout.write(buffer.data(), buffer.size());
+            buffer.clear();
+        };
+
+        bool rootFound = walker.run(args.walkRoot,
+                                    [&](size_t worker, AixMetadata::MetadataResult& result) {
+            std::string& buffer = buffers[worker];
+            AixMetadata::JsonWriter writer(buffer, false, args.stringValues);
+            writer.writeResult(result);
+            buffer += '\n';
+            if (buffer.size() >= WALK_OUTPUT_CHUNK) {
+                writeOut(buffer);
+            }
+        });
+
+        for (auto& buffer : buffers) {
+            writeOut(buffer);
         }
+        std::cout.flush();
 
-        case CommandLineArgs::Mode::File: {
-            AixMetadata::FileCollector collector;
-            result = collector.collect(args.identifier);
-            break;
+        if (args.showStats) {
+            printWalkStats(walker);
         }
 
-        case CommandLineArgs::Mode::Port: {
-            AixMetadata::PortCollector collector(args.protocol);
-            result = collector.collect(args.identifier);
-            break;
+        return (rootFound && walker.getErrorCount() == 0) ? 0 : 1;
+    }
+
+    // Load batch queries
+    if (!args.batchFile.empty()) {
+        bool ok;
+        std::string errorMessage;
+
+        if (args.batchFile == "-") {
+            ok = readBatch(std::cin, args.requests, errorMessage);
+        } else {
+            std::ifstream batch(args.batchFile.c_str());
+            if (!batch.is_open()) {
+                std::cerr << "Error: Cannot open batch file: " << args.batchFile << std::endl;
+                return 1;
+            }
+            ok = readBatch(batch, args.requests, errorMessage);
         }
 
-        default:
-            std::cerr << "Error: Internal error - unknown mode" << std::endl;
+        if (!ok) {
+            std::cerr << "Error: " << errorMessage << std::endl;
             return 1;
+        }
+    }
+
+    // One collector per type, shared by every query (of the first worker)
+    AixMetadata::CollectorSet collectors(args.protocol);
+    collectors.setTimestampFormat(args.timePrecision, args.timeOffset);
+    collectors.setCommandLineLimit(args.commandLineLimit);
+    collectors.setOpenFileLimit(args.openFileLimit);
+    collectors.setFindOpeners(args.findOpeners);
+    AixMetadata::BatchExecutor executor(collectors, args.jobs, args.protocol);
+    const AixMetadata::BatchExecutor::Order order = args.unordered
+        ? AixMetadata::BatchExecutor::Order::Completion
+        : AixMetadata::BatchExecutor::Order::Input;
+
+    // Single query: keep the plain object output
+    if (args.requests.size() == 1 && args.batchFile.empty() &&
+        !args.allProcesses && !args.ndjson) {
+        AixMetadata::MetadataResult result = collectors.collect(args.requests[0]);
+
+        // Output result as JSON
+        std::string json = AixMetadata::JsonFormatter::format(result, args.prettyPrint,
+                                                            args.stringValues);
+        std::cout << json << std::endl;
+
+        if (args.showStats) {
+            printStats(executor);
+        }
+
+        // Return appropriate exit code
+        return result.success ? 0 : 1;
+    }
+
+    bool allSucceeded = true;
+
+    // Full process table snapshot from one bulk enumeration
+    std::vector<AixMetadata::MetadataResult> snapshot;
+    if (args.allProcesses) {
+        collectors.process().collectAll(snapshot);
+        for (const auto& result : snapshot) {
+            allSucceeded = allSucceeded && result.success;
+        }
     }
 
-    // Output result as JSON
-    std::string json = AixMetadata::JsonFormatter::format(result, args.prettyPrint);
-    std::cout << json << std::endl;
+    if (args.ndjson) {
+        // One output buffer reused for every line
+        std::string line;
+        AixMetadata::JsonWriter writer(line, false, args.stringValues);
+
+        for (const auto& result : snapshot) {
+            line.clear();
+            writer.writeResult(result);
+            line += '\n';
+            std::cout.write(line.data(), line.size());
+        }
+
+        // Stream one compact object per line as results become available
+        executor.run(args.requests, order,
+                     [&](size_t, AixMetadata::MetadataResult& result) {
+            allSucceeded = allSucceeded && result.success;
+
+            line.clear();
+            writer.writeResult(result);
+            line += '\n';
+            std::cout.write(line.data(), line.size());
+        });
+        std::cout.flush();
+    } else {
+        std::vector<AixMetadata::MetadataResult> results;
+        results.swap(snapshot);
+        results.reserve(results.size() + args.requests.size());
+
+        executor.run(args.requests, order,
+                     [&](size_t, AixMetadata::MetadataResult& result) {
+            allSucceeded = allSucceeded && result.success;
+            results.push_back(std::move(result));
+        });
+
+        std::cout << AixMetadata::JsonFormatter::formatArray(results, args.prettyPrint,
+                                                          args.stringValues)
+                  << std::endl;
+    }
+
+    if (args.showStats) {
+        printStats(executor);
+    }
 
-    // Return appropriate exit code
-    return result.success ? 0 : 1;
+    return allSucceeded ? 0 : 1;
 }
@@ -0,0 +1,126 @@
+/**
+ * @file open_file_list.cpp
+ * @brief Implementation of the open file descriptor list
+ */
+
+#include "open_file_list.h"
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace AixMetadata {
+
+namespace {
+
+/**
+ * @brief Whether a link target starts with a literal prefix
+ */
+template <size_t N>
+bool hasPrefix(const char* target, size_t length, const char (&prefix)[N]) {
+    return length >= N - 1 && memcmp(target, prefix, N - 1) == 0;
+}
+
+} // anonymous namespace
+
+void OpenFileList::clearCounts() {
+    for (size_t i = 0; i < TYPE_COUNT; i++) {
+        m_typeCounts[i] = 0;
+    }
+}
+
+bool OpenFileList::read(pid_t pid, size_t limit) {
+    m_entries.clear();
+    m_truncatedTargets.clear();
+    m_total = 0;
+    m_truncated = false;
+    clearCounts();
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", static_cast<int>(pid));
+
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    DIR* dir = fdopendir(fd);
+    if (dir == nullptr) {
+        close(fd);
+        return false;
+    }
+
+    char target[PATH_MAX];
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        m_total++;
+        if (limit > 0 && m_total > limit) {
+            // Past the limit only the count is kept
+            m_truncated = true;
+            continue;
+        }
+
+        m_entries.append(entry->d_name);
+
+        Type type = Other;
+        ssize_t len = readlinkat(fd, entry->d_name, target, sizeof(target));
+        if (len > 0) {
+            if (static_cast<size_t>(len) == sizeof(target)) {
+                // A full buffer may hold only the start of the target
+                m_truncatedTargets.append(entry->d_name);
+                m_truncatedTargets.push_back('\0');
+            }
+            m_entries.push_back(':');
+            m_entries.append(target, static_cast<size_t>(len));
+            type = classifyTarget(target, static_cast<size_t>(len));
+        } else {
+            // AIX entries are not symlinks; the type is that of the open file
+            struct stat st;
+            if (fstatat(fd, entry->d_name, &st, 0) == 0) {
+                type = S_ISSOCK(st.st_mode) ? Socket
+                     : S_ISFIFO(st.st_mode) ? Pipe
+                     : File;
+            }
+        }
+        m_entries.push_back('\0');
+        m_typeCounts[type]++;
+    }
+
+    closedir(dir);
+    return true;
+}
+
+const char* OpenFileList::typeName(Type type) {
+    switch (type) {
+        case File:      return "file";
+        case Socket:    return "socket";
+        case Pipe:      return "pipe";
+        case AnonInode: return "anon_inode";
+        default:        return "other";
+    }
+}
+
+OpenFileList::Type OpenFileList::classifyTarget(const char* target, size_t length) {
+    if (length > 0 && target[0] == '/') {
+        return File;
+    }
+    if (hasPrefix(target, length, "socket:")) {
+        return Socket;
+    }
+    if (hasPrefix(target, length, "pipe:")) {
+        return Pipe;
+    }
+    if (hasPrefix(target, length, "anon_inode:")) {
+        return AnonInode;
+    }
+    return Other;
+}
+
+} // namespace AixMetadata
@@ -0,0 +1,218 @@
+/**
+ * @file opener_scanner.cpp
+ * @brief Implementation of the open file reverse lookup
+ */
+
+#include "opener_scanner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef _AIX
+#include <sys/procfs.h>
+#endif
+
+namespace AixMetadata {
+
+namespace {
+
+// Processes a worker claims at a time; small enough to balance a few
+// processes with huge fd tables, large enough to keep the counter cold
+const size_t PIDS_PER_CLAIM = 16;
+
+/**
+ * @brief Parse a numeric /proc directory entry name
+ */
+bool parsePidName(const char* name, pid_t& pid) {
+    if (*name < '1' || *name > '9') return false;
+    char* endPtr = nullptr;
+    long value = std::strtol(name, &endPtr, 10);
+    if (*endPtr != '\0' || value <= 0) return false;
+    pid = static_cast<pid_t>(value);
+    return true;
+}
+
+/**
+ * @brief Order openers by PID, then descriptor
+ */
+bool openerLess(const FileOpener& a, const FileOpener& b) {
+    return a.pid != b.pid ? a.pid < b.pid : a.fd < b.fd;
+}
+
+} // anonymous namespace
+
+OpenerScanner::OpenerScanner(size_t workers)
+    : m_workers(workers),
+      m_procFd(-1),
+      m_device(0),
+      m_inode(0),
+      m_next(0),
+      m_scans(0),
+      m_descriptors(0) {
+    if (m_workers == 0) {
+        m_workers = std::thread::hardware_concurrency();
+        if (m_workers == 0) {
+            m_workers = 1;
+        }
+    }
+}
+
+bool OpenerScanner::find(uint64_t device, uint64_t inode, std::vector<FileOpener>& openers) {
+    openers.clear();
+
+    m_procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (m_procFd < 0) {
+        return false;
+    }
+    DIR* proc = fdopendir(m_procFd);
+    if (proc == nullptr) {
+        close(m_procFd);
+        m_procFd = -1;
+        return false;
+    }
+
+    m_pids.clear();
+    struct dirent* entry;
+    while ((entry = readdir(proc)) != nullptr) {
+        pid_t pid;
+        if (parsePidName(entry->d_name, pid)) {
+            m_pids.push_back(pid);
+        }
+    }
+
+    m_device = device;
+    m_inode = inode;
+    m_next = 0;
+    m_found.clear();
+
+    // The calling thread is the first worker; there is no point in more
+    // workers than claims
+    const size_t workers =
+        std::min(m_workers, (m_pids.size() + PIDS_PER_CLAIM - 1) / PIDS_PER_CLAIM);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers; ++i) {
+        threads.push_back(std::thread(&OpenerScanner::work, this));
+    }
+    work();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    closedir(proc);
+    m_procFd = -1;
+    m_scans++;
+
+    std::sort(m_found.begin(), m_found.end(), openerLess);
+    openers.swap(m_found);
+    return true;
+}
+
+void OpenerScanner::work() {
+    std::vector<FileOpener> found;
+    uint64_t descriptors = 0;
+
+    for (;;) {
+        const size_t begin = m_next.fetch_add(PIDS_PER_CLAIM);
+        if (begin >= m_pids.size()) {
+            break;
+        }
+        const size_t end = std::min(begin + PIDS_PER_CLAIM, m_pids.size());
+        for (size_t i = begin; i < end; ++i) {
+            descriptors += scanProcess(m_pids[i], found);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_found.insert(m_found.end(), found.begin(), found.end());
+    m_descriptors += descriptors;
+}
+
+uint64_t OpenerScanner::scanProcess(pid_t pid, std::vector<FileOpener>& found) {
+    char path[32];
+    snprintf(path, sizeof(path), "%d/fd", static_cast<int>(pid));
+
+    int fd = openat(m_procFd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        // Process exited or we lack permission
+        return 0;
+    }
+    DIR* dir = fdopendir(fd);
+    if (dir == nullptr) {
+        close(fd);
+        return 0;
+    }
+
+    uint64_t descriptors = 0;
+    bool described = false;
+    FileOpener opener;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        descriptors++;
+
+        struct stat st;
+        if (fstatat(fd, entry->d_name, &st, 0) != 0 ||
+            static_cast<uint64_t>(st.st_ino) != m_inode ||
+            static_cast<uint64_t>(st.st_dev) != m_device) {
+            continue;
+        }
+
+        if (!described) {
+            described = true;
+            opener.pid = pid;
+            describeProcess(opener);
+        }
+        opener.fd = std::atoi(entry->d_name);
+        found.push_back(opener);
+    }
+
+    closedir(dir);
+    return descriptors;
+}
+
+void OpenerScanner::describeProcess(FileOpener& opener) {
+    char path[32];
+
+#ifdef _AIX
+    snprintf(path, sizeof(path), "%d/psinfo", static_cast<int>(opener.pid));
+    int fd = openat(m_procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        struct psinfo info;
+        if (read(fd, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info))) {
+            opener.processName = info.pr_fname;
+            opener.uid = info.pr_uid;
+        }
+        close(fd);
+    }
+#else
+    snprintf(path, sizeof(path), "%d/comm", static_cast<int>(opener.pid));
+    int fd = openat(m_procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        char comm[64];
+        ssize_t n = read(fd, comm, sizeof(comm) - 1);
+        if (n > 0) {
+            if (comm[n - 1] == '\n') n--;
+            opener.processName.assign(comm, static_cast<size_t>(n));
+        }
+        close(fd);
+    }
+
+    snprintf(path, sizeof(path), "%d", static_cast<int>(opener.pid));
+    struct stat st;
+    if (fstatat(m_procFd, path, &st, 0) == 0) {
+        opener.uid = st.st_uid;
+    }
+#endif
+}
+
+} // namespace AixMetadata
@@ -3,189 +3,367 @@
  * @brief Implementation of network port metadata collector for AIX
  *
  * This file implements the PortCollector class which retrieves network
- * connection information for a given port number.
+ * connection information for a port, a list/range of ports, or every
+ * listening socket. However many ports are requested, the socket tables
+ * (or netstat output) are scanned once, testing each socket against a
+ * PortSet bitmap.
  *
  * On AIX, we use a combination of approaches:
- *   1. Parse 'netstat -Aan' output for connection information
- *   2. Use 'rmsock' or 'lsof' to correlate sockets to processes (if available)
+ *   1. Parse 'netstat -Aan' output for connection information (or read the
+ *      socket tables natively where a SocketTableReader backend exists).
+ *      netstat and lsof are spawned directly by a CommandRunner: no shell,
+ *      no grep, and a timeout on each run
+ *   2. Map socket inodes to processes with a one-shot SocketOwnerIndex, or
+ *      use 'rmsock' or 'lsof' to correlate sockets to processes (if available)
  *   3. Fall back to netstat -p for process information
  *
  * Note: Some operations may require root privileges for full process information.
  */
 
 #include "port_collector.h"
+#include "identity_cache.h"
 
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <cerrno>
 #include <sstream>
 #include <algorithm>
 #include <cstdio>
+#include <map>
 #include <unistd.h>
 
 namespace AixMetadata {
 
-PortCollector::PortCollector(Protocol proto)
-    : m_protocol(proto) {
+namespace {
+
+/**
+ * @brief A non-owning view of part of a buffer
+ */
+struct TextSpan {
+    const char* data;
+    size_t size;
+
+    TextSpan() : data(nullptr), size(0) {}
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
 }
 
-MetadataResult PortCollector::collect(const std::string& identifier) {
-    MetadataResult result;
-    result.type = "port";
-    result.identifier = identifier;
+/**
+ * @brief Return the next whitespace-delimited token, advancing the cursor
+ */
+bool nextToken(const char*& p, const char* end, TextSpan& token) {
+    while (p < end && isBlank(*p)) ++p;
+    if (p >= end) return false;
+    token.data = p;
+    while (p < end && !isBlank(*p)) ++p;
+    token.size = static_cast<size_t>(p - token.data);
+    return true;
+}
 
-    uint16_t port;
-    if (!parsePort(identifier, port)) {
-        return createErrorResult(identifier, "Invalid port number: " + identifier);
+/**
+ * @brief Whether a token is a kernel socket address (netstat -A column)
+ */
+bool looksLikeSocketAddress(const TextSpan& token) {
+    if (token.size <= 10) return false;
+    for (size_t i = 0; i < token.size; ++i) {
+        char c = token.data[i];
+        bool hex = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+        if (!hex) return false;
     }
+    return true;
+}
 
-    std::vector<ConnectionInfo> connections;
-
-    // Collect TCP connections if requested
-    if (m_protocol == Protocol::TCP || m_protocol == Protocol::Both) {
-        collectTcpConnections(port, connections);
+/**
+ * @brief Split "addr.port" at the last dot
+ */
+bool splitAtLastDot(const TextSpan& field, TextSpan& addr, TextSpan& port) {
+    const char* dot = nullptr;
+    for (const char* c = field.data + field.size; c > field.data; --c) {
+        if (c[-1] == '.') {
+            dot = c - 1;
+            break;
+        }
     }
+    if (dot == nullptr) return false;
 
-    // Collect UDP connections if requested
-    if (m_protocol == Protocol::UDP || m_protocol == Protocol::Both) {
-        collectUdpConnections(port, connections);
+    addr.data = field.data;
+    addr.size = static_cast<size_t>(dot - field.data);
+    port.data = dot + 1;
+    port.size = field.size - addr.size - 1;
+    return true;
+}
+
+/**
+ * @brief Parse a decimal port field
+ *
+ * Fields that are not plain decimal numbers (e.g. "*") are rejected.
+ */
+bool parsePortField(const char* data, size_t size, uint16_t& port) {
+    if (size == 0) return false;
+    unsigned value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        char c = data[i];
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<unsigned>(c - '0');
+        if (value > 65535) return false;
     }
+    port = static_cast<uint16_t>(value);
+    return true;
+}
 
-    if (connections.empty()) {
-        result.success = true;
-        result.addAttribute("status", "no_connections_found");
-        result.addAttribute("port", identifier);
-        return result;
+bool parsePortField(const TextSpan& field, uint16_t& port) {
+    return parsePortField(field.data, field.size, port);
+}
+
+bool parsePortField(const std::string& field, uint16_t& port) {
+    return parsePortField(field.data(), field.size(), port);
+}
+
+/**
+ * @brief The requested port a connection was matched on
+ *
+ * The local port wins when both ends are in the set.
+ */
+uint16_t matchedPort(const ConnectionInfo& conn, const PortSet& ports) {
+    uint16_t port = 0;
+    if (parsePortField(conn.localPort, port) && ports.contains(port)) {
+        return port;
     }
+    if (parsePortField(conn.remotePort, port) && ports.contains(port)) {
+        return port;
+    }
+    return 0;
+}
 
-    result.success = true;
-    result.addAttribute("port", identifier);
-    result.addAttribute("num_connections", static_cast<int64_t>(connections.size()));
-
-    // Add each connection as attributes
-    int connIndex = 0;
-    for (const auto& conn : connections) {
-        std::ostringstream prefix;
-        prefix << "connection_" << connIndex << "_";
-        std::string pfx = prefix.str();
-
-        result.addAttribute(pfx + "protocol", conn.protocol);
-        result.addAttribute(pfx + "local_address", conn.localAddress);
-        result.addAttribute(pfx + "local_port", conn.localPort);
-        result.addAttribute(pfx + "remote_address", conn.remoteAddress);
-        result.addAttribute(pfx + "remote_port", conn.remotePort);
-        result.addAttribute(pfx + "state", conn.state);
+/**
+ * @brief Append one object per connection to an ObjectList attribute
+ */
+void addConnectionObjects(MetadataAttribute& list,
+                          std::vector<ConnectionInfo>::const_iterator begin,
+                          std::vector<ConnectionInfo>::const_iterator end) {
+    list.children.reserve(static_cast<size_t>(end - begin));
+
+    for (auto it = begin; it != end; ++it) {
+        const ConnectionInfo& conn = *it;
+        MetadataAttribute& entry = list.addObject();
+
+        entry.addField("protocol", conn.protocol);
+        entry.addField("local_address", conn.localAddress);
+        entry.addField("local_port", conn.localPort);
+        entry.addField("remote_address", conn.remoteAddress);
+        entry.addField("remote_port", conn.remotePort);
+        entry.addField("state", conn.state);
 
         if (conn.pid > 0) {
-            std::ostringstream pidStr;
-            pidStr << conn.pid;
-            result.addAttribute(pfx + "pid", pidStr.str());
+            entry.addField("pid", static_cast<int64_t>(conn.pid));
         }
 
         if (!conn.processName.empty()) {
-            result.addAttribute(pfx + "process", conn.processName);
+            entry.addField("process", conn.processName);
         }
 
         if (!conn.user.empty()) {
-            result.addAttribute(pfx + "user", conn.user);
+            entry.addField("user", conn.user);
         }
-
-        connIndex++;
     }
+}
 
-    return result;
+// Largest number of ranges passed to lsof; larger sets select the whole
+// protocol and are matched by local port
+const size_t MAX_LSOF_RANGES = 64;
+
+} // anonymous namespace
+
+const char* const PortCollector::LISTENING_IDENTIFIER = "listening";
+
+PortCollector::PortCollector(Protocol proto)
+    : m_protocol(proto),
+      m_socketReader(createNativeSocketTableReader()) {
 }
 
-bool PortCollector::parsePort(const std::string& identifier, uint16_t& port) {
-    char* endPtr = nullptr;
-    long value = std::strtol(identifier.c_str(), &endPtr, 10);
+MetadataResult PortCollector::collect(const std::string& identifier) {
+    MetadataResult result;
+    result.type = "port";
+    result.identifier = identifier;
 
-    // Check for conversion errors
-    if (endPtr == identifier.c_str() || *endPtr != '\0') {
-        return false;
+    PortSet ports;
+    bool listeningOnly = false;
+    uint16_t port = 0;
+    bool singlePort = parsePort(identifier, port);
+
+    if (singlePort) {
+        ports.add(port);
+    } else if (identifier == LISTENING_IDENTIFIER) {
+        ports.addAll();
+        listeningOnly = true;
+    } else {
+        std::string errorMessage;
+        if (!ports.parse(identifier, errorMessage)) {
+            return createErrorResult(identifier, errorMessage);
+        }
     }
 
-    // Check for valid port range (1-65535)
-    if (value <= 0 || value > 65535) {
-        return false;
+    std::vector<ConnectionInfo> connections;
+
+    // Prefer the native socket table backend; fall back to netstat
+    bool nativeTable = m_socketReader &&
+        m_socketReader->read(ports, listeningOnly, m_protocol, connections);
+    if (!nativeTable) {
+        connections.clear();
+        collectNetstatConnections(ports, listeningOnly, connections);
     }
 
-    port = static_cast<uint16_t>(value);
-    return true;
-}
+    resolveOwners(ports, nativeTable, connections);
 
-bool PortCollector::executeCommand(const std::string& cmd, std::string& output) {
-    // Use popen to execute command and capture output
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (pipe == nullptr) {
-        return false;
+    result.success = true;
+
+    if (singlePort) {
+        if (connections.empty()) {
+            result.addAttribute("status", "no_connections_found");
+            result.addAttribute("port", static_cast<uint64_t>(port));
+            return result;
+        }
+
+        result.addAttribute("port", static_cast<uint64_t>(port));
+        result.addAttribute("num_connections", static_cast<int64_t>(connections.size()));
+
+        // One object per connection
+        addConnectionObjects(result.addObjectList("connections"),
+                             connections.begin(), connections.end());
+        return result;
     }
 
-    char buffer[4096];
-    output.clear();
+    if (connections.empty()) {
+        result.addAttribute("status", "no_connections_found");
+        return result;
+    }
 
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        output += buffer;
+    // Group by the requested port each connection matched, ascending
+    std::vector<std::pair<uint16_t, size_t>> order;
+    order.reserve(connections.size());
+    for (size_t i = 0; i < connections.size(); ++i) {
+        order.push_back(std::make_pair(matchedPort(connections[i], ports), i));
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<uint16_t, size_t>& a,
+                        const std::pair<uint16_t, size_t>& b) {
+                         return a.first < b.first;
+                     });
+
+    std::vector<ConnectionInfo> sorted;
+    sorted.reserve(connections.size());
+    for (const auto& entry : order) {
+        sorted.push_back(std::move(connections[entry.second]));
     }
 
-    int status = pclose(pipe);
-    return (status == 0 || !output.empty());
-}
+    size_t numPorts = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i == 0 || order[i].first != order[i - 1].first) {
+            numPorts++;
+        }
+    }
 
-bool PortCollector::collectTcpConnections(uint16_t port, std::vector<ConnectionInfo>& connections) {
-    std::string output;
+    result.addAttribute("num_ports", static_cast<int64_t>(numPorts));
+    result.addAttribute("num_connections", static_cast<int64_t>(sorted.size()));
 
-    // On AIX, use netstat -Aan for TCP connections
-    // -A: show socket address (for process correlation)
-    // -a: show all sockets
-    // -n: numeric addresses
-    std::string cmd = "netstat -Aan -f inet 2>/dev/null | grep tcp";
+    // One object per port, each holding its connections
+    MetadataAttribute& portList = result.addObjectList("ports");
+    portList.children.reserve(numPorts);
 
-    if (!executeCommand(cmd, output)) {
-        // Try alternative command without -A
-        cmd = "netstat -an -f inet 2>/dev/null | grep tcp";
-        if (!executeCommand(cmd, output)) {
-            return false;
+    size_t groupStart = 0;
+    while (groupStart < order.size()) {
+        size_t groupEnd = groupStart + 1;
+        while (groupEnd < order.size() && order[groupEnd].first == order[groupStart].first) {
+            groupEnd++;
         }
-    }
 
-    parseNetstatOutput(output, port, "tcp", connections);
+        MetadataAttribute& group = portList.addObject();
+        group.addField("port", static_cast<uint64_t>(order[groupStart].first));
+        group.addField("num_connections", static_cast<int64_t>(groupEnd - groupStart));
+        addConnectionObjects(group.addObjectList("connections"),
+                             sorted.begin() + static_cast<std::ptrdiff_t>(groupStart),
+                             sorted.begin() + static_cast<std::ptrdiff_t>(groupEnd));
 
-    // Also check IPv6
-    cmd = "netstat -Aan -f inet6 2>/dev/null | grep tcp";
-    if (executeCommand(cmd, output)) {
-        parseNetstatOutput(output, port, "tcp6", connections);
+        groupStart = groupEnd;
     }
 
-    return true;
+    return result;
 }
 
-bool PortCollector::collectUdpConnections(uint16_t port, std::vector<ConnectionInfo>& connections) {
-    std::string output;
+void PortCollector::collectNetstatConnections(const PortSet& ports, bool listeningOnly,
+                                              std::vector<ConnectionInfo>& connections) {
+    // One netstat per address family serves both TCP and UDP
+    std::string inetOutput;
+    std::string inet6Output;
 
-    // On AIX, use netstat for UDP
-    std::string cmd = "netstat -Aan -f inet 2>/dev/null | grep udp";
+    if (!runNetstat("inet", true, inetOutput)) {
+        // Try alternative command without -A
+        if (!runNetstat("inet", false, inetOutput)) {
+            return;
+        }
+    }
+    bool haveInet6 = runNetstat("inet6", true, inet6Output);
 
-    if (!executeCommand(cmd, output)) {
-        cmd = "netstat -an -f inet 2>/dev/null | grep udp";
-        if (!executeCommand(cmd, output)) {
-            return false;
+    // Collect TCP connections if requested
+    if (m_protocol == Protocol::TCP || m_protocol == Protocol::Both) {
+        parseNetstatOutput(inetOutput, ports, listeningOnly, "tcp", connections);
+        if (haveInet6) {
+            parseNetstatOutput(inet6Output, ports, listeningOnly, "tcp6", connections);
         }
     }
 
-    parseNetstatOutput(output, port, "udp", connections);
+    // Collect UDP connections if requested
+    if (m_protocol == Protocol::UDP || m_protocol == Protocol::Both) {
+        parseNetstatOutput(inetOutput, ports, listeningOnly, "udp", connections);
+        if (haveInet6) {
+            parseNetstatOutput(inet6Output, ports, listeningOnly, "udp6", connections);
+        }
+    }
+}
 
-    // Also check IPv6
-    cmd = "netstat -Aan -f inet6 2>/dev/null | grep udp";
-    if (executeCommand(cmd, output)) {
-        parseNetstatOutput(output, port, "udp6", connections);
+bool PortCollector::parsePort(const std::string& identifier, uint16_t& port) {
+    char* endPtr = nullptr;
+    long value = std::strtol(identifier.c_str(), &endPtr, 10);
+
+    // Check for conversion errors
+    if (endPtr == identifier.c_str() || *endPtr != '\0') {
+        return false;
     }
 
+    // Check for valid port range (1-65535)
+    if (value <= 0 || value > 65535) {
+        return false;
+    }
+
+    port = static_cast<uint16_t>(value);
     return true;
 }
 
+bool PortCollector::runNetstat(const char* family, bool withSocketAddress,
+                               std::string& output) {
+    // On AIX, use netstat -Aan
+    // -A: show socket address (for process correlation)
+    // -a: show all sockets
+    // -n: numeric addresses
+    std::vector<std::string> argv;
+    argv.push_back("netstat");
+    argv.push_back(withSocketAddress ? "-Aan" : "-an");
+    argv.push_back("-f");
+    argv.push_back(family);
+
+    int exitStatus;
+    if (!m_runner.run(argv, output, &exitStatus)) {
+        return false;
+    }
+    return (exitStatus == 0 || !output.empty());
+}
+
 void PortCollector::parseNetstatOutput(const std::string& output,
-                                        uint16_t port,
+                                        const PortSet& ports,
+                                        bool listeningOnly,
                                         const std::string& protocol,
                                         std::vector<ConnectionInfo>& connections) {
     /*
@@ -199,97 +377,165 @@ void PortCollector::parseNetstatOutput(const std::string& output,
      * tcp4       0      0  *.22               *.*                LISTEN
      */
 
-    std::istringstream stream(output);
-    std::string line;
+    const char* p = output.data();
+    const char* end = p + output.size();
 
-    while (std::getline(stream, line)) {
-        if (line.empty()) continue;
+    while (p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char* lineEnd = (nl != nullptr) ? nl : end;
+        const char* cur = p;
+        p = (nl != nullptr) ? nl + 1 : end;
 
-        // Tokenize the line
-        std::vector<std::string> tokens;
-        std::istringstream lineStream(line);
-        std::string token;
-
-        while (lineStream >> token) {
-            tokens.push_back(token);
-        }
-
-        // We need at least 6 tokens for connection info
         // With -A: socket proto recvq sendq local foreign state
         // Without -A: proto recvq sendq local foreign state
-        if (tokens.size() < 6) continue;
+        TextSpan first;
+        if (!nextToken(cur, lineEnd, first)) continue;
+
+        // A long all-hex first token is the socket address
+        TextSpan proto = first;
+        bool complete = true;
+        if (looksLikeSocketAddress(first)) {
+            complete = nextToken(cur, lineEnd, proto);
+        }
 
-        // Determine if first token is socket address (hex) or protocol
-        size_t offset = 0;
-        std::string socketAddr;
+        // Keep only lines for this protocol (tcp4/tcp6/tcp, udp4/...)
+        if (!complete || proto.size < 3 || memcmp(proto.data, protocol.data(), 3) != 0) {
+            continue;
+        }
 
-        // Check if first token looks like a hex address
-        if (tokens[0].length() > 10 && tokens[0].find_first_not_of("0123456789abcdefABCDEF") == std::string::npos) {
-            socketAddr = tokens[0];
-            offset = 1;
+        // recv-q, send-q
+        TextSpan token;
+        for (size_t i = 0; i < 2 && complete; ++i) {
+            complete = nextToken(cur, lineEnd, token);
         }
 
-        if (tokens.size() < offset + 6) continue;
+        TextSpan localAddr;
+        TextSpan foreignAddr;
+        if (!complete ||
+            !nextToken(cur, lineEnd, localAddr) ||
+            !nextToken(cur, lineEnd, foreignAddr)) {
+            continue;
+        }
 
-        std::string localAddr = tokens[offset + 3];
-        std::string foreignAddr = tokens[offset + 4];
-        std::string state = tokens[offset + 5];
+        // UDP sockets have no state column
+        TextSpan state;
+        if (!nextToken(cur, lineEnd, state) && proto.data[0] != 'u') {
+            continue;
+        }
 
         // Extract port from local address (format: addr.port or *.port)
-        size_t lastDot = localAddr.rfind('.');
-        if (lastDot == std::string::npos) continue;
-
-        std::string localPortStr = localAddr.substr(lastDot + 1);
-        std::string localIp = localAddr.substr(0, lastDot);
-
-        // Check if this matches our target port
-        char* endPtr;
-        long localPortNum = std::strtol(localPortStr.c_str(), &endPtr, 10);
-        if (*endPtr != '\0' || localPortNum != port) {
-            // Also check foreign port for established connections
-            size_t foreignLastDot = foreignAddr.rfind('.');
-            if (foreignLastDot != std::string::npos) {
-                std::string foreignPortStr = foreignAddr.substr(foreignLastDot + 1);
-                long foreignPortNum = std::strtol(foreignPortStr.c_str(), &endPtr, 10);
-                if (*endPtr != '\0' || foreignPortNum != port) {
-                    continue;  // Neither local nor foreign port matches
-                }
-            } else {
+        TextSpan localIp;
+        TextSpan localPort;
+        if (!splitAtLastDot(localAddr, localIp, localPort)) continue;
+
+        // Check if this matches a requested port, or else the foreign port
+        TextSpan foreignIp;
+        TextSpan foreignPort;
+        bool hasForeignPort = splitAtLastDot(foreignAddr, foreignIp, foreignPort);
+
+        uint16_t number;
+        bool localMatch = parsePortField(localPort, number) && ports.contains(number);
+        bool foreignNumeric = hasForeignPort && parsePortField(foreignPort, number);
+
+        if (listeningOnly) {
+            // Listening TCP sockets are in LISTEN; unconnected UDP sockets
+            // have no foreign port ("*.*")
+            bool listening = (proto.data[0] == 'u')
+                ? !foreignNumeric
+                : (state.size == 6 && memcmp(state.data, "LISTEN", 6) == 0);
+            if (!localMatch || !listening) {
                 continue;
             }
+        } else if (!localMatch && !(foreignNumeric && ports.contains(number))) {
+            continue;
         }
 
         // This connection matches our port
         ConnectionInfo info;
         info.protocol = protocol;
-        info.localAddress = localIp;
-        info.localPort = localPortStr;
-        info.state = state;
-        info.pid = 0;
-
-        // Parse foreign address
-        size_t foreignLastDot = foreignAddr.rfind('.');
-        if (foreignLastDot != std::string::npos) {
-            info.remoteAddress = foreignAddr.substr(0, foreignLastDot);
-            info.remotePort = foreignAddr.substr(foreignLastDot + 1);
+        info.localAddress.assign(localIp.data, localIp.size);
+        info.localPort.assign(localPort.data, localPort.size);
+        info.state.assign(state.data, state.size);
+
+        if (hasForeignPort) {
+            info.remoteAddress.assign(foreignIp.data, foreignIp.size);
+            info.remotePort.assign(foreignPort.data, foreignPort.size);
         } else {
-            info.remoteAddress = foreignAddr;
+            info.remoteAddress.assign(foreignAddr.data, foreignAddr.size);
             info.remotePort = "*";
         }
 
-        // Try to find process info using the socket address
-        if (!socketAddr.empty()) {
-            findProcessForPort(port, protocol, info);
+        connections.push_back(info);
+    }
+}
+
+void PortCollector::resolveOwners(const PortSet& ports, bool nativeTable,
+                                  std::vector<ConnectionInfo>& connections) {
+    bool indexBuilt = false;
+    std::map<std::string, std::map<uint16_t, ConnectionInfo>> lsofByProtocol;
+
+    for (auto& conn : connections) {
+        if (nativeTable && conn.inode == 0) {
+            // TIME_WAIT and orphaned sockets: no process holds them, and
+            // the kernel reports uid 0 for them. lsof matches by local
+            // port and would name the port's listener
+            continue;
         }
 
-        connections.push_back(info);
+        // The table's socket owner, for sockets no process is found for
+        if (conn.inode != 0 && conn.uid != static_cast<uid_t>(-1)) {
+            IdentityCache::instance().lookupUser(conn.uid, conn.user);
+        }
+
+        if (conn.inode != 0) {
+            // Build the index lazily, once per query
+            if (!indexBuilt) {
+                indexBuilt = true;
+                m_ownerIndex.build();
+            }
+
+            if (m_ownerIndex.isBuilt()) {
+                const SocketOwner* owner = m_ownerIndex.find(conn.inode);
+                if (owner != nullptr) {
+                    conn.pid = owner->pid;
+                    conn.processName = owner->processName;
+
+                    conn.user.clear();
+                    IdentityCache::instance().lookupUser(owner->uid, conn.user);
+                }
+                continue;
+            }
+        }
+
+        // netstat (no inodes) or no index on this platform: lsof once per protocol
+        // ("tcp" and "tcp6" share one lsof run) for the whole port set
+        std::string baseProtocol = conn.protocol.substr(0, 3);
+        auto it = lsofByProtocol.find(baseProtocol);
+        if (it == lsofByProtocol.end()) {
+            it = lsofByProtocol.insert(
+                std::make_pair(baseProtocol, std::map<uint16_t, ConnectionInfo>())).first;
+            findProcessesForPorts(ports, baseProtocol, it->second);
+        }
+
+        // lsof reports each socket under its local port
+        uint16_t localPort;
+        if (!parsePortField(conn.localPort, localPort)) {
+            continue;
+        }
+        auto owner = it->second.find(localPort);
+        if (owner == it->second.end()) {
+            continue;
+        }
+
+        conn.pid = owner->second.pid;
+        conn.processName = owner->second.processName;
+        conn.user = owner->second.user;
     }
 }
 
-void PortCollector::findProcessForPort(uint16_t port,
-                                        const std::string& protocol,
-                                        ConnectionInfo& info) {
-#ifdef _AIX
+void PortCollector::findProcessesForPorts(const PortSet& ports,
+                                          const std::string& protocol,
+                                          std::map<uint16_t, ConnectionInfo>& owners) {
     /*
      * On AIX, we can use 'rmsock' to find the process holding a socket.
      * However, rmsock is primarily for releasing sockets, not querying.
@@ -300,15 +546,26 @@ void PortCollector::findProcessForPort(uint16_t port,
      * 3. Parse /proc filesystem
      *
      * For this PoC, we'll try lsof first as it's commonly installed.
+     * lsof itself filters on protocol and ports ("-i TCP:22,80,8000-8100").
      */
 
-    std::ostringstream cmd;
-    cmd << "lsof -i :" << port << " -n -P 2>/dev/null | grep -i " << protocol;
+    std::string selector = (protocol.compare(0, 3, "udp") == 0) ? "UDP" : "TCP";
+    std::vector<std::pair<uint16_t, uint16_t>> ranges = ports.ranges();
+    if (!ports.isAll() && ranges.size() <= MAX_LSOF_RANGES) {
+        selector += ':';
+        selector += ports.toString();
+    }
+
+    std::vector<std::string> argv;
+    argv.push_back("lsof");
+    argv.push_back("-i");
+    argv.push_back(selector);
+    argv.push_back("-n");
+    argv.push_back("-P");
 
     std::string output;
-    if (!executeCommand(cmd.str(), output) || output.empty()) {
+    if (!m_runner.run(argv, output) || output.empty()) {
         // lsof not available or no results
-        // Try alternative: use procfiles on all processes (expensive)
         return;
     }
 
@@ -316,60 +573,82 @@ void PortCollector::findProcessForPort(uint16_t port,
      * lsof output format:
      * COMMAND   PID USER   FD   TYPE  DEVICE SIZE/OFF NODE NAME
      * sshd     1234 root    3u  IPv4   12345      0t0  TCP *:22 (LISTEN)
+     * sshd     1250 root    4u  IPv4   12399      0t0  TCP 10.0.0.1:22->10.0.0.2:51234 (ESTABLISHED)
      */
 
-    std::istringstream stream(output);
-    std::string line;
-
-    while (std::getline(stream, line)) {
-        if (line.empty()) continue;
-
-        std::vector<std::string> tokens;
-        std::istringstream lineStream(line);
-        std::string token;
-
-        while (lineStream >> token) {
-            tokens.push_back(token);
+    const char* p = output.data();
+    const char* end = p + output.size();
+
+    while (p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char* lineEnd = (nl != nullptr) ? nl : end;
+        const char* cur = p;
+        p = (nl != nullptr) ? nl + 1 : end;
+
+        TextSpan command;
+        TextSpan pid;
+        TextSpan user;
+        if (!nextToken(cur, lineEnd, command) ||
+            !nextToken(cur, lineEnd, pid) ||
+            !nextToken(cur, lineEnd, user)) {
+            continue;
         }
 
         // Skip header line
-        if (tokens.size() < 2 || tokens[0] == "COMMAND") continue;
-
-        if (tokens.size() >= 3) {
-            info.processName = tokens[0];
+        std::string pidText(pid.data, pid.size);
+        char* endPtr;
+        long pidValue = std::strtol(pidText.c_str(), &endPtr, 10);
+        if (*endPtr != '\0' || pidValue <= 0) {
+            continue;
+        }
 
-            char* endPtr;
-            long pid = std::strtol(tokens[1].c_str(), &endPtr, 10);
-            if (*endPtr == '\0') {
-                info.pid = static_cast<pid_t>(pid);
+        // NAME follows the NODE column ("TCP"/"UDP")
+        TextSpan token;
+        TextSpan name;
+        bool afterNode = false;
+        while (nextToken(cur, lineEnd, token)) {
+            if (afterNode) {
+                name = token;
+                break;
             }
-
-            info.user = tokens[2];
-            break;  // Use first match
+            afterNode = (token.size == 3 &&
+                         (memcmp(token.data, "TCP", 3) == 0 || memcmp(token.data, "UDP", 3) == 0));
+        }
+        if (name.size == 0) {
+            continue;
         }
-    }
-#else
-    // Non-AIX: try lsof on Linux/macOS
-    std::ostringstream cmd;
-    cmd << "lsof -i :" << port << " -n -P 2>/dev/null | grep -v COMMAND | head -1";
 
-    std::string output;
-    if (executeCommand(cmd.str(), output) && !output.empty()) {
-        std::istringstream lineStream(output);
-        std::string procName, pidStr, user;
-
-        if (lineStream >> procName >> pidStr >> user) {
-            info.processName = procName;
-            info.user = user;
-
-            char* endPtr;
-            long pid = std::strtol(pidStr.c_str(), &endPtr, 10);
-            if (*endPtr == '\0') {
-                info.pid = static_cast<pid_t>(pid);
+        // Local endpoint is before "->"; its port follows the last ':'
+        size_t localSize = name.size;
+        for (size_t i = 0; i + 1 < name.size; ++i) {
+            if (name.data[i] == '-' && name.data[i + 1] == '>') {
+                localSize = i;
+                break;
             }
         }
+        const char* colon = nullptr;
+        for (size_t i = localSize; i > 0; --i) {
+            if (name.data[i - 1] == ':') {
+                colon = name.data + i - 1;
+                break;
+            }
+        }
+        uint16_t localPort;
+        if (colon == nullptr ||
+            !parsePortField(colon + 1, static_cast<size_t>(name.data + localSize - colon - 1),
+                            localPort)) {
+            continue;
+        }
+
+        // Use the first process listed for each port
+        if (owners.find(localPort) != owners.end()) {
+            continue;
+        }
+        ConnectionInfo& info = owners[localPort];
+        info.processName.assign(command.data, command.size);
+        info.pid = static_cast<pid_t>(pidValue);
+        info.user.assign(user.data, user.size);
     }
-#endif
 }
 
 } // namespace AixMetadata
@@ -0,0 +1,145 @@
+/**
+ * @file port_set.cpp
+ * @brief Implementation of the port bitmap
+ */
+
+#include "port_set.h"
+
+namespace AixMetadata {
+
+namespace {
+
+const size_t WORDS = 65536 / 64;
+
+/**
+ * @brief Parse a decimal port in 1-65535 from [begin, end)
+ */
+bool parsePortNumber(const std::string& spec, size_t begin, size_t end, uint16_t& port) {
+    if (begin >= end) {
+        return false;
+    }
+
+    unsigned value = 0;
+    for (size_t i = begin; i < end; ++i) {
+        char c = spec[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<unsigned>(c - '0');
+        if (value > 65535) {
+            return false;
+        }
+    }
+
+    if (value == 0) {
+        return false;
+    }
+    port = static_cast<uint16_t>(value);
+    return true;
+}
+
+} // anonymous namespace
+
+PortSet::PortSet()
+    : m_bits(WORDS, 0), m_count(0) {
+}
+
+bool PortSet::parse(const std::string& spec, std::string& errorMessage) {
+    PortSet parsed;
+    size_t pos = 0;
+
+    while (pos <= spec.size()) {
+        size_t comma = spec.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = spec.size();
+        }
+
+        size_t dash = spec.find('-', pos);
+        uint16_t first;
+        uint16_t last;
+
+        if (dash != std::string::npos && dash < comma) {
+            if (!parsePortNumber(spec, pos, dash, first) ||
+                !parsePortNumber(spec, dash + 1, comma, last) || last < first) {
+                errorMessage = "Invalid port range: " + spec.substr(pos, comma - pos);
+                return false;
+            }
+        } else {
+            if (!parsePortNumber(spec, pos, comma, first)) {
+                errorMessage = "Invalid port number: " + spec.substr(pos, comma - pos);
+                return false;
+            }
+            last = first;
+        }
+
+        parsed.addRange(first, last);
+        pos = comma + 1;
+    }
+
+    *this = parsed;
+    return true;
+}
+
+void PortSet::add(uint16_t port) {
+    uint64_t bit = static_cast<uint64_t>(1) << (port & 63);
+    uint64_t& word = m_bits[port >> 6];
+    if ((word & bit) == 0) {
+        word |= bit;
+        m_count++;
+    }
+}
+
+void PortSet::addRange(uint16_t first, uint16_t last) {
+    for (uint32_t port = first; port <= last; ++port) {
+        add(static_cast<uint16_t>(port));
+    }
+}
+
+void PortSet::addAll() {
+    addRange(1, 65535);
+}
+
+std::vector<std::pair<uint16_t, uint16_t>> PortSet::ranges() const {
+    std::vector<std::pair<uint16_t, uint16_t>> result;
+
+    uint32_t port = 0;
+    while (port < 65536) {
+        // Skip empty words quickly
+        if (m_bits[port >> 6] == 0) {
+            port = (port | 63) + 1;
+            continue;
+        }
+        if (!contains(static_cast<uint16_t>(port))) {
+            ++port;
+            continue;
+        }
+
+        uint32_t first = port;
+        while (port < 65536 && contains(static_cast<uint16_t>(port))) {
+            ++port;
+        }
+        result.push_back(std::make_pair(static_cast<uint16_t>(first),
+                                        static_cast<uint16_t>(port - 1)));
+    }
+
+    return result;
+}
+
+std::string PortSet::toString() const {
+    std::string spec;
+
+    for (const auto& range : ranges()) {
+        if (!spec.empty()) {
+            spec += ',';
+        }
+        spec += std::to_string(range.first);
+        if (range.second != range.first) {
+            spec += '-';
+            spec += std::to_string(range.second);
+        }
+    }
+
+    return spec;
+}
+
+} // namespace AixMetadata
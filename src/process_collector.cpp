@@ -9,21 +9,23 @@
  *   - getprocs64(): Retrieves process table entries
  *   - /proc/[pid]/psinfo: Process status information
  *   - /proc/[pid]/cred: Process credentials
- *   - /proc/[pid]/fd/: Open file descriptors
+ *   - /proc/[pid]/fd/: Open file descriptors (see OpenFileList)
  *   - readlink(): For symlink resolution
  */
 
 #include "process_collector.h"
+#include "identity_cache.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
+#include <limits>
 #include <cstring>
 #include <cerrno>
 #include <sstream>
 #include <fstream>
 #include <dirent.h>
 #include <unistd.h>
-#include <pwd.h>
-#include <grp.h>
 #include <fcntl.h>
 #include <time.h>
 #include <sys/types.h>
@@ -34,38 +36,228 @@
 #include <sys/procfs.h>
 #endif
 
+namespace {
+
+// Number of process table entries fetched per getprocs64() call in bulk mode
+const int PROCS_PER_BATCH = 1024;
+
+#ifndef _AIX
+
+// Bytes of a /proc file read in the batched pass; longer files are
+// finished with plain reads
+const size_t PROC_READ_SIZE = 4096;
+
+/**
+ * @brief A /proc/<pid> file kept in ProcessContext
+ */
+struct ProcFile {
+    const char* name;
+    std::string AixMetadata::ProcessContext::*contents;
+    bool AixMetadata::ProcessContext::*found;
+    bool commandLine;       ///< Read only up to the command line limit
+};
+
+const ProcFile PROC_FILES[] = {
+    { "stat", &AixMetadata::ProcessContext::stat, &AixMetadata::ProcessContext::hasStat, false },
+    { "status", &AixMetadata::ProcessContext::status, &AixMetadata::ProcessContext::hasStatus, false },
+    { "cmdline", &AixMetadata::ProcessContext::cmdline, &AixMetadata::ProcessContext::hasCmdline, true }
+};
+
+const size_t PROC_FILE_COUNT = sizeof(PROC_FILES) / sizeof(PROC_FILES[0]);
+
+#endif
+
+#ifdef _AIX
+
+// Initial getargs() buffer; doubled until the argument list fits
+const size_t ARGS_BUFFER_SIZE = 4096;
+
+#endif
+
+/**
+ * @brief Add the cmdline attribute from NUL-separated arguments
+ * @param result Output: MetadataResult to populate
+ * @param args Arguments, each followed by a NUL (the last one may lack it)
+ * @param limit Bytes to report at most (0: no limit)
+ * @param truncated Whether args has already been cut short
+ */
+void addCommandLine(AixMetadata::MetadataResult& result, std::string&& args,
+                    size_t limit, bool truncated) {
+    if (limit > 0 && args.size() > limit) {
+        args.resize(limit);
+        truncated = true;
+    }
+    if (!args.empty() && args[args.size() - 1] != '\0') {
+        args.push_back('\0');
+    }
+
+    result.addPackedList("cmdline", std::move(args));
+    if (truncated) {
+        result.addAttribute("cmdline_truncated", true);
+    }
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Fields of /proc/<pid>/stat reported as basic info
+ */
+struct LinuxProcStat {
+    const char* comm;         ///< Start of comm within the file contents
+    size_t commLength;
+    char state;
+    int64_t ppid;
+    int64_t pgrp;
+    int64_t session;
+    int64_t ttyNr;
+    uint64_t flags;
+    uint64_t utime;           ///< Clock ticks
+    uint64_t stime;           ///< Clock ticks
+    int64_t priority;
+    int64_t nice;
+    int64_t numThreads;
+    uint64_t startTime;       ///< Clock ticks after boot
+    uint64_t vsize;           ///< Bytes
+    int64_t rss;              ///< Pages
+};
+
+/**
+ * @brief Parse /proc/<pid>/stat
+ *
+ * comm runs from the first '(' to the last ')': a process may put spaces
+ * and parentheses in its name, but every later field is numeric (apart
+ * from the state letter).
+ *
+ * @param text File contents
+ * @param st Output: parsed fields
+ * @return false if the contents are malformed
+ */
+bool parseProcStat(const std::string& text, LinuxProcStat& st) {
+    const size_t open = text.find('(');
+    const size_t close = text.rfind(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) {
+        return false;
+    }
+    st.comm = text.c_str() + open + 1;
+    st.commLength = close - open - 1;
+
+    const char* p = text.c_str() + close + 1;
+    if (*p != ' ' || p[1] == '\0') {
+        return false;
+    }
+    st.state = p[1];
+    p += 2;
+
+    // Fields 4 to 24, as numbered in proc(5)
+    int64_t fields[25];
+    for (int field = 4; field <= 24; field++) {
+        char* end;
+        fields[field] = static_cast<int64_t>(std::strtoll(p, &end, 10));
+        if (end == p) {
+            return false;
+        }
+        p = end;
+    }
+
+    st.ppid = fields[4];
+    st.pgrp = fields[5];
+    st.session = fields[6];
+    st.ttyNr = fields[7];
+    st.flags = static_cast<uint64_t>(fields[9]);
+    st.utime = static_cast<uint64_t>(fields[14]);
+    st.stime = static_cast<uint64_t>(fields[15]);
+    st.priority = fields[18];
+    st.nice = fields[19];
+    st.numThreads = fields[20];
+    st.startTime = static_cast<uint64_t>(fields[22]);
+    st.vsize = static_cast<uint64_t>(fields[23]);
+    st.rss = fields[24];
+    return true;
+}
+
+/**
+ * @brief First number on the "<key>:" line of /proc/<pid>/status
+ * @return false if there is no such line
+ */
+bool statusValue(const std::string& status, const char* key, unsigned long& value) {
+    const size_t keyLength = std::strlen(key);
+    size_t pos = 0;
+    while (pos < status.size()) {
+        if (status.compare(pos, keyLength, key) == 0 && status[pos + keyLength] == ':') {
+            char* end;
+            const char* start = status.c_str() + pos + keyLength + 1;
+            value = std::strtoul(start, &end, 10);
+            return end != start;
+        }
+        pos = status.find('\n', pos);
+        if (pos == std::string::npos) {
+            break;
+        }
+        pos++;
+    }
+    return false;
+}
+
+/**
+ * @brief Read the boot time from the "btime" line of /proc/stat
+ * @return Seconds since the Epoch, or -1 if unknown
+ */
+int64_t readBootTime() {
+    FILE* file = std::fopen("/proc/stat", "re");
+    if (file == nullptr) {
+        return -1;
+    }
+
+    int64_t boot = -1;
+    char* line = nullptr;
+    size_t capacity = 0;
+    while (getline(&line, &capacity, file) > 0) {
+        if (std::strncmp(line, "btime ", 6) == 0) {
+            boot = static_cast<int64_t>(std::strtoll(line + 6, nullptr, 10));
+            break;
+        }
+    }
+    std::free(line);
+    std::fclose(file);
+    return boot;
+}
+
+/**
+ * @brief Boot time, read once per run
+ */
+int64_t bootTime() {
+    static const int64_t boot = readBootTime();
+    return boot;
+}
+
+/**
+ * @brief Clock ticks per second of /proc/<pid>/stat times
+ */
+long clockTicks() {
+    static const long ticks = sysconf(_SC_CLK_TCK);
+    return ticks;
+}
+
+#endif // __linux__
+
+} // anonymous namespace
+
 namespace AixMetadata {
 
 MetadataResult ProcessCollector::collect(const std::string& identifier) {
-    MetadataResult result;
-    result.type = "process";
-    result.identifier = identifier;
-
     pid_t pid;
     if (!parsePid(identifier, pid)) {
         return createErrorResult(identifier, "Invalid PID format: " + identifier);
     }
 
-    // Collect basic process info first - this validates the process exists
-    if (!collectBasicInfo(pid, result)) {
+    // Fetch the process record once; this also validates the process exists
+    ProcessContext ctx;
+    if (!fetchContext(pid, ctx)) {
         return createErrorResult(identifier,
             "Process not found or access denied for PID: " + identifier);
     }
 
-    result.success = true;
-
-    // Collect additional information (these may partially fail but we continue)
-    collectExecutablePath(pid, result);
-    collectWorkingDirectory(pid, result);
-    collectCommandLine(pid, result);
-    collectCredentials(pid, result);
-    collectOpenFiles(pid, result);
-    collectWparInfo(pid, result);
-
-    // Optionally collect environment (may be restricted)
-    // collectEnvironment(pid, result);
-
-    return result;
+    return collectFromContext(ctx, identifier);
 }
 
 bool ProcessCollector::parsePid(const std::string& identifier, pid_t& pid) {
@@ -86,19 +278,199 @@ bool ProcessCollector::parsePid(const std::string& identifier, pid_t& pid) {
     return true;
 }
 
-bool ProcessCollector::collectBasicInfo(pid_t pid, MetadataResult& result) {
+MetadataResult ProcessCollector::collectFromContext(const ProcessContext& ctx,
+                                                    const std::string& identifier) {
+    MetadataResult result;
+    result.type = "process";
+    result.identifier = identifier;
+    m_processCount++;
+
+    // Collect basic process info first
+    if (!collectBasicInfo(ctx, result)) {
+        return createErrorResult(identifier,
+            "Process not found or access denied for PID: " + identifier);
+    }
+
+    result.success = true;
+
+    // Collect additional information (these may partially fail but we continue)
+    collectExecutablePath(ctx, result);
+    collectWorkingDirectory(ctx, result);
+    collectCommandLine(ctx, result);
+    collectCredentials(ctx, result);
+    collectOpenFiles(ctx, result);
+    collectWparInfo(ctx, result);
+
+    // Optionally collect environment (may be restricted)
+    // collectEnvironment(ctx, result);
+
+    return result;
+}
+
+void ProcessCollector::collectAll(std::vector<MetadataResult>& results) {
 #ifdef _AIX
-    // Use getprocs64() to get process information on AIX
-    struct procentry64 procInfo;
-    pid_t inputPid = pid;
+    // Enumerate the process table in large batches. getprocs64 advances
+    // 'index' past the last process returned, so each call continues
+    // where the previous one stopped.
+    std::vector<struct procentry64> entries(PROCS_PER_BATCH);
+    pid_t index = 0;
+    ProcessContext ctx;
+
+    for (;;) {
+        int count = getprocs64(&entries[0], sizeof(struct procentry64),
+                               nullptr, 0, &index, PROCS_PER_BATCH);
+        m_kernelFetchCount++;
+        if (count <= 0) {
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            ctx.pid = entries[i].pi_pid;
+            ctx.entry = entries[i];
+            results.push_back(collectFromContext(ctx, std::to_string(static_cast<long long>(ctx.pid))));
+        }
+
+        if (count < PROCS_PER_BATCH) {
+            break;
+        }
+    }
+#else
+    // Single walk over /proc; each numeric entry is a PID. The /proc files
+    // are read for a batch of processes at a time.
+    DIR* proc = opendir("/proc");
+    if (proc == nullptr) {
+        return;
+    }
+
+    const size_t batchSize = std::max<size_t>(1, m_io.getDepth() / PROC_FILE_COUNT);
+    std::vector<ProcessContext> batch;
+    batch.reserve(batchSize);
+
+    for (;;) {
+        struct dirent* entry = readdir(proc);
+        pid_t pid;
+        if (entry != nullptr && entry->d_name[0] >= '1' && entry->d_name[0] <= '9' &&
+            parsePid(entry->d_name, pid)) {
+            batch.push_back(ProcessContext());
+            batch.back().pid = pid;
+        }
+
+        if (batch.size() == batchSize || (entry == nullptr && !batch.empty())) {
+            readProcFiles(batch);
+            for (const ProcessContext& ctx : batch) {
+#ifdef __linux__
+                // Exited since /proc was listed
+                if (!ctx.hasStat) {
+                    continue;
+                }
+#endif
+                results.push_back(collectFromContext(ctx, std::to_string(static_cast<long long>(ctx.pid))));
+            }
+            batch.clear();
+        }
+
+        if (entry == nullptr) {
+            break;
+        }
+    }
+
+    closedir(proc);
+#endif
+}
+
+bool ProcessCollector::fetchContext(pid_t pid, ProcessContext& ctx) {
+    ctx.pid = pid;
 
+#ifdef _AIX
     // getprocs64 returns the number of processes copied
     // We request 1 process starting from the given PID
-    int count = getprocs64(&procInfo, sizeof(procInfo), nullptr, 0, &inputPid, 1);
+    pid_t inputPid = pid;
+    int count = getprocs64(&ctx.entry, sizeof(ctx.entry), nullptr, 0, &inputPid, 1);
+    m_kernelFetchCount++;
 
-    if (count != 1 || procInfo.pi_pid != pid) {
-        return false;
+    // If the PID does not exist, getprocs64 returns the next process instead
+    return count == 1 && ctx.entry.pi_pid == pid;
+#else
+    std::vector<ProcessContext> contexts(1);
+    contexts[0].pid = pid;
+    readProcFiles(contexts);
+    ctx = std::move(contexts[0]);
+#ifdef __linux__
+    // Not there, or hidden from us (hidepid)
+    return ctx.hasStat;
+#else
+    return true;
+#endif
+#endif
+}
+
+#ifndef _AIX
+void ProcessCollector::readProcFiles(std::vector<ProcessContext>& contexts) {
+    m_kernelFetchCount++;
+
+    const size_t count = contexts.size() * PROC_FILE_COUNT;
+    std::vector<std::string> paths(count);
+    std::vector<int> fds(count);
+    std::vector<int> bytes(count);
+
+    for (size_t i = 0; i < count; i++) {
+        const ProcessContext& ctx = contexts[i / PROC_FILE_COUNT];
+        paths[i] = "/proc/" + std::to_string(static_cast<long long>(ctx.pid)) + "/" +
+                   PROC_FILES[i % PROC_FILE_COUNT].name;
+        m_io.open(AT_FDCWD, paths[i].c_str(), O_RDONLY, fds[i]);
+    }
+    m_io.submit();
+
+    // One byte past the command line limit shows whether it was reached
+    const size_t commandLineMax = m_commandLineLimit > 0
+                                      ? m_commandLineLimit + 1
+                                      : std::numeric_limits<size_t>::max();
+
+    for (size_t i = 0; i < count; i++) {
+        ProcessContext& ctx = contexts[i / PROC_FILE_COUNT];
+        const ProcFile& file = PROC_FILES[i % PROC_FILE_COUNT];
+        std::string& contents = ctx.*file.contents;
+        ctx.*file.found = fds[i] >= 0;
+        contents.clear();
+        if (fds[i] >= 0) {
+            contents.resize(file.commandLine ? std::min(PROC_READ_SIZE, commandLineMax)
+                                             : PROC_READ_SIZE);
+            m_io.read(fds[i], &contents[0], contents.size(), 0, bytes[i]);
+        }
+    }
+    m_io.submit();
+
+    // Files longer than the batched read grow until they fit
+    for (size_t i = 0; i < count; i++) {
+        if (fds[i] < 0) {
+            continue;
+        }
+
+        const ProcFile& file = PROC_FILES[i % PROC_FILE_COUNT];
+        std::string& contents = contexts[i / PROC_FILE_COUNT].*file.contents;
+        const size_t max = file.commandLine ? commandLineMax
+                                            : std::numeric_limits<size_t>::max();
+        size_t length = bytes[i] > 0 ? static_cast<size_t>(bytes[i]) : 0;
+        while (length == contents.size() && length < max) {
+            contents.resize(std::min(length * 2, max));
+            ssize_t more = pread(fds[i], &contents[length], contents.size() - length,
+                                 static_cast<off_t>(length));
+            if (more <= 0) {
+                break;
+            }
+            length += static_cast<size_t>(more);
+        }
+        contents.resize(length);
+        m_io.close(fds[i]);
     }
+    m_io.submit();
+}
+#endif
+
+bool ProcessCollector::collectBasicInfo(const ProcessContext& ctx, MetadataResult& result) {
+#ifdef _AIX
+    // Use the getprocs64() entry already fetched for this process
+    const struct procentry64& procInfo = ctx.entry;
 
     // Basic process identifiers
     result.addAttribute("pid", static_cast<int64_t>(procInfo.pi_pid));
@@ -113,14 +485,16 @@ bool ProcessCollector::collectBasicInfo(pid_t pid, MetadataResult& result) {
     result.addAttribute("uid", static_cast<int64_t>(procInfo.pi_uid));
 
     // Resolve username
-    struct passwd* pwd = getpwuid(procInfo.pi_uid);
-    if (pwd != nullptr) {
-        result.addAttribute("user", std::string(pwd->pw_name));
+    IdentityCache& identities = IdentityCache::instance();
+    std::string userName;
+    gid_t primaryGid;
+    if (identities.lookupUser(procInfo.pi_uid, userName, &primaryGid)) {
+        result.addAttribute("user", userName);
         // Get primary group from passwd entry
-        result.addAttribute("gid", static_cast<int64_t>(pwd->pw_gid));
-        struct group* grp = getgrgid(pwd->pw_gid);
-        if (grp != nullptr) {
-            result.addAttribute("group", std::string(grp->gr_name));
+        result.addAttribute("gid", static_cast<int64_t>(primaryGid));
+        std::string groupName;
+        if (identities.lookupGroup(primaryGid, groupName)) {
+            result.addAttribute("group", groupName);
         }
     }
 
@@ -169,72 +543,160 @@ bool ProcessCollector::collectBasicInfo(pid_t pid, MetadataResult& result) {
 
     return true;
 
+#elif defined(__linux__)
+    LinuxProcStat st;
+    if (!ctx.hasStat || !parseProcStat(ctx.stat, st)) {
+        return false;
+    }
+
+    // Basic process identifiers
+    result.addAttribute("pid", static_cast<int64_t>(ctx.pid));
+    result.addAttribute("ppid", st.ppid);
+    result.addAttribute("pgid", st.pgrp);
+    result.addAttribute("sid", st.session);
+
+    // Process name (command)
+    result.addAttribute("comm", std::string(st.comm, st.commLength));
+
+    // Real user and group from /proc/<pid>/status
+    IdentityCache& identities = IdentityCache::instance();
+    unsigned long uid;
+    if (statusValue(ctx.status, "Uid", uid)) {
+        result.addAttribute("uid", static_cast<int64_t>(uid));
+        std::string userName;
+        if (identities.lookupUser(static_cast<uid_t>(uid), userName)) {
+            result.addAttribute("user", userName);
+        }
+    }
+    unsigned long gid;
+    if (statusValue(ctx.status, "Gid", gid)) {
+        result.addAttribute("gid", static_cast<int64_t>(gid));
+        std::string groupName;
+        if (identities.lookupGroup(static_cast<gid_t>(gid), groupName)) {
+            result.addAttribute("group", groupName);
+        }
+    }
+
+    // Process state
+    result.addAttribute("state", stateToString(static_cast<unsigned char>(st.state)));
+
+    // Priority and nice value
+    result.addAttribute("priority", st.priority);
+    result.addAttribute("nice", st.nice);
+
+    // CPU usage over the process's lifetime, in percent (as ps -o c)
+    const long ticks = clockTicks();
+    struct timespec now;
+    int64_t cpu = 0;
+    if (ticks > 0 && clock_gettime(CLOCK_BOOTTIME, &now) == 0) {
+        const int64_t uptimeTicks = static_cast<int64_t>(now.tv_sec) * ticks +
+                                    static_cast<int64_t>(now.tv_nsec) / (1000000000L / ticks);
+        const int64_t elapsed = uptimeTicks - static_cast<int64_t>(st.startTime);
+        if (elapsed > 0) {
+            cpu = static_cast<int64_t>((st.utime + st.stime) * 100 / static_cast<uint64_t>(elapsed));
+        }
+    }
+    result.addAttribute("cpu", cpu);
+
+    // Memory information (in KB)
+    long pageSize = sysconf(_SC_PAGESIZE);
+    result.addAttribute("virtual_size_kb", static_cast<uint64_t>(st.vsize / 1024));
+    if (pageSize > 0 && st.rss >= 0) {
+        result.addAttribute("resident_size_kb",
+            static_cast<uint64_t>(st.rss) * static_cast<uint64_t>(pageSize) / 1024);
+    }
+
+    // Start time: clock ticks after boot
+    const int64_t boot = bootTime();
+    if (boot >= 0 && ticks > 0) {
+        result.addAttribute("start_time",
+            timeToString(static_cast<uint64_t>(boot) + st.startTime / static_cast<uint64_t>(ticks)));
+    }
+
+    // Number of threads
+    result.addAttribute("num_threads", st.numThreads);
+
+    // Flags
+    std::ostringstream flagsHex;
+    flagsHex << "0x" << std::hex << st.flags;
+    result.addAttribute("flags", flagsHex.str());
+
+    // TTY (controlling terminal), encoded as in the kernel's new_encode_dev()
+    if (st.ttyNr != 0) {
+        const uint64_t tty = static_cast<uint64_t>(st.ttyNr);
+        std::ostringstream ttyStr;
+        ttyStr << "major:" << ((tty >> 8) & 0xfff)
+               << ",minor:" << ((tty & 0xff) | ((tty >> 12) & 0xfff00));
+        result.addAttribute("tty", ttyStr.str());
+    } else {
+        result.addAttribute("tty", "none");
+    }
+
+    return true;
+
 #else
     // Non-AIX stub for compilation testing on other platforms
     // This allows development on macOS with actual testing on AIX
-    result.addAttribute("pid", static_cast<int64_t>(pid));
+    result.addAttribute("pid", static_cast<int64_t>(ctx.pid));
     result.addAttribute("_note", "Process info collection requires AIX");
     return true;
 #endif
 }
 
-void ProcessCollector::collectCommandLine(pid_t pid, MetadataResult& result) {
+void ProcessCollector::collectCommandLine(const ProcessContext& ctx, MetadataResult& result) {
 #ifdef _AIX
-    // On AIX, we can try to read from /proc/[pid]/psinfo or use getargs()
-    // First, try using getargs64() which gets the command line arguments
-
-    struct procentry64 procInfo;
-    pid_t inputPid = pid;
-
-    if (getprocs64(&procInfo, sizeof(procInfo), nullptr, 0, &inputPid, 1) == 1) {
-        // Buffer for command line arguments
-        char argsBuffer[4096];
-        memset(argsBuffer, 0, sizeof(argsBuffer));
-
-        // getargs64 retrieves the command line arguments
-        if (getargs(&procInfo, sizeof(procInfo), argsBuffer, sizeof(argsBuffer)) == 0) {
-            // Arguments are null-separated, convert to space-separated
-            std::string cmdline;
-            char* ptr = argsBuffer;
-            bool first = true;
-            while (ptr < argsBuffer + sizeof(argsBuffer) && *ptr != '\0') {
-                if (!first) {
-                    cmdline += " ";
-                }
-                cmdline += ptr;
-                ptr += strlen(ptr) + 1;
-                first = false;
-
-                // Safety check to avoid infinite loop
-                if (ptr >= argsBuffer + sizeof(argsBuffer)) break;
+    // getargs() fills the buffer with NUL-terminated arguments followed by
+    // an empty one, silently cutting them at the buffer size. Retry with a
+    // doubled buffer until the terminating empty argument fits.
+    {
+        // getargs() takes a non-const entry
+        struct procentry64 procInfo = ctx.entry;
+
+        const size_t limit = m_commandLineLimit;
+        std::string args;
+        size_t size = ARGS_BUFFER_SIZE;
+        bool truncated = false;
+        for (;;) {
+            args.assign(size, '\0');
+            if (getargs(&procInfo, sizeof(procInfo), &args[0], static_cast<int>(size)) != 0) {
+                return;
             }
 
-            if (!cmdline.empty()) {
-                result.addAttribute("cmdline", cmdline);
+            if (args[0] == '\0') {
+                // No arguments
+                args.clear();
+                break;
+            }
+            const size_t end = args.find(std::string(2, '\0'));
+            if (end != std::string::npos) {
+                args.resize(end + 1);
+                break;
             }
+            if (limit > 0 && size > limit) {
+                truncated = true;
+                break;
+            }
+            size *= 2;
+        }
+
+        if (!args.empty() || truncated) {
+            addCommandLine(result, std::move(args), limit, truncated);
         }
     }
 #else
-    // Non-AIX stub
-    std::ostringstream path;
-    path << "/proc/" << pid << "/cmdline";
-
-    std::ifstream file(path.str(), std::ios::binary);
-    if (file.is_open()) {
-        std::string cmdline;
-        std::getline(file, cmdline, '\0');
-        result.addAttribute("cmdline", cmdline);
+    if (ctx.hasCmdline) {
+        addCommandLine(result, std::string(ctx.cmdline), m_commandLineLimit, false);
     }
 #endif
 }
 
-void ProcessCollector::collectEnvironment(pid_t pid, MetadataResult& result) {
+void ProcessCollector::collectEnvironment(const ProcessContext& ctx, MetadataResult& result) {
 #ifdef _AIX
     // On AIX, environment variables can be retrieved using getevars()
-    struct procentry64 procInfo;
-    pid_t inputPid = pid;
+    {
+        // getevars() takes a non-const entry
+        struct procentry64 procInfo = ctx.entry;
 
-    if (getprocs64(&procInfo, sizeof(procInfo), nullptr, 0, &inputPid, 1) == 1) {
         char envBuffer[8192];
         memset(envBuffer, 0, sizeof(envBuffer));
 
@@ -257,62 +719,39 @@ void ProcessCollector::collectEnvironment(pid_t pid, MetadataResult& result) {
 #endif
 }
 
-void ProcessCollector::collectOpenFiles(pid_t pid, MetadataResult& result) {
-#ifdef _AIX
-    // On AIX, we can use /proc/[pid]/fd directory to list open file descriptors
-    std::ostringstream fdDirPath;
-    fdDirPath << "/proc/" << pid << "/fd";
-
-    DIR* dir = opendir(fdDirPath.str().c_str());
-    if (dir == nullptr) {
+void ProcessCollector::collectOpenFiles(const ProcessContext& ctx, MetadataResult& result) {
+    if (!m_openFiles.read(ctx.pid, m_openFileLimit)) {
         // May not have permission to read /proc/[pid]/fd
         return;
     }
 
-    std::vector<std::string> openFds;
-    struct dirent* entry;
-
-    while ((entry = readdir(dir)) != nullptr) {
-        // Skip . and ..
-        if (entry->d_name[0] == '.') {
-            continue;
-        }
-
-        // Each entry in /proc/[pid]/fd is a symlink to the actual file
-        std::ostringstream fdPath;
-        fdPath << fdDirPath.str() << "/" << entry->d_name;
-
-        char linkTarget[PATH_MAX];
-        ssize_t len = readlink(fdPath.str().c_str(), linkTarget, sizeof(linkTarget) - 1);
-
-        if (len > 0) {
-            linkTarget[len] = '\0';
-            std::ostringstream fdInfo;
-            fdInfo << entry->d_name << ":" << linkTarget;
-            openFds.push_back(fdInfo.str());
-        } else {
-            // If we can't read the link, just record the fd number
-            openFds.push_back(std::string(entry->d_name));
-        }
+    // As in 1.x, no open_files list for a process without descriptors;
+    // open_files_count still tells it apart from an unreadable table
+    if (!m_openFiles.entries().empty()) {
+        result.addPackedList("open_files", std::move(m_openFiles.entries()));
+    }
+    result.addAttribute("open_files_count", m_openFiles.getTotalCount());
+    if (m_openFiles.isTruncated()) {
+        result.addAttribute("open_files_truncated", true);
+    }
+    if (!m_openFiles.truncatedTargets().empty()) {
+        result.addPackedList("open_files_truncated_fds",
+                             std::move(m_openFiles.truncatedTargets()));
     }
 
-    closedir(dir);
-
-    if (!openFds.empty()) {
-        result.addAttribute("open_files", openFds);
+    MetadataAttribute& types = result.addObject("open_file_types");
+    for (int i = 0; i < OpenFileList::TYPE_COUNT; i++) {
+        const OpenFileList::Type type = static_cast<OpenFileList::Type>(i);
+        types.addField(OpenFileList::typeName(type), m_openFiles.getTypeCount(type));
     }
-#else
-    // Non-AIX stub
-    result.addAttribute("open_files_note", "Open files collection requires AIX");
-#endif
 }
 
-void ProcessCollector::collectExecutablePath(pid_t pid, MetadataResult& result) {
+void ProcessCollector::collectExecutablePath(const ProcessContext& ctx, MetadataResult& result) {
 #ifdef _AIX
     // On AIX, the executable path can be read from /proc/[pid]/object/a.out
     // which is a symlink to the executable
     std::ostringstream exePath;
-    exePath << "/proc/" << pid << "/object/a.out";
+    exePath << "/proc/" << ctx.pid << "/object/a.out";
 
     char linkTarget[PATH_MAX];
     ssize_t len = readlink(exePath.str().c_str(), linkTarget, sizeof(linkTarget) - 1);
@@ -321,20 +760,14 @@ void ProcessCollector::collectExecutablePath(pid_t pid, MetadataResult& result)
         linkTarget[len] = '\0';
         result.addAttribute("exe_path", std::string(linkTarget));
     } else {
-        // Alternative: try to get it from procentry64
-        struct procentry64 procInfo;
-        pid_t inputPid = pid;
-
-        if (getprocs64(&procInfo, sizeof(procInfo), nullptr, 0, &inputPid, 1) == 1) {
-            // Try to construct path from pi_comm if available
-            // Note: pi_comm only contains the basename
-            result.addAttribute("exe_name", std::string(procInfo.pi_comm));
-        }
+        // Alternative: take the name from procentry64
+        // Note: pi_comm only contains the basename
+        result.addAttribute("exe_name", std::string(ctx.entry.pi_comm));
     }
 #else
     // Non-AIX stub
     std::ostringstream exePath;
-    exePath << "/proc/" << pid << "/exe";
+    exePath << "/proc/" << ctx.pid << "/exe";
 
     char linkTarget[PATH_MAX];
     ssize_t len = readlink(exePath.str().c_str(), linkTarget, sizeof(linkTarget) - 1);
@@ -346,11 +779,11 @@ void ProcessCollector::collectExecutablePath(pid_t pid, MetadataResult& result)
 #endif
 }
 
-void ProcessCollector::collectWorkingDirectory(pid_t pid, MetadataResult& result) {
+void ProcessCollector::collectWorkingDirectory(const ProcessContext& ctx, MetadataResult& result) {
 #ifdef _AIX
     // On AIX, current working directory is at /proc/[pid]/cwd
     std::ostringstream cwdPath;
-    cwdPath << "/proc/" << pid << "/cwd";
+    cwdPath << "/proc/" << ctx.pid << "/cwd";
 
     char linkTarget[PATH_MAX];
     ssize_t len = readlink(cwdPath.str().c_str(), linkTarget, sizeof(linkTarget) - 1);
@@ -362,7 +795,7 @@ void ProcessCollector::collectWorkingDirectory(pid_t pid, MetadataResult& result
 #else
     // Non-AIX stub - same path on Linux
     std::ostringstream cwdPath;
-    cwdPath << "/proc/" << pid << "/cwd";
+    cwdPath << "/proc/" << ctx.pid << "/cwd";
 
     char linkTarget[PATH_MAX];
     ssize_t len = readlink(cwdPath.str().c_str(), linkTarget, sizeof(linkTarget) - 1);
@@ -374,12 +807,12 @@ void ProcessCollector::collectWorkingDirectory(pid_t pid, MetadataResult& result
 #endif
 }
 
-void ProcessCollector::collectCredentials(pid_t pid, MetadataResult& result) {
+void ProcessCollector::collectCredentials(const ProcessContext& ctx, MetadataResult& result) {
 #ifdef _AIX
     // On AIX, credential information can be read from /proc/[pid]/cred
     // The cred file contains a prcred structure
     std::ostringstream credPath;
-    credPath << "/proc/" << pid << "/cred";
+    credPath << "/proc/" << ctx.pid << "/cred";
 
     int fd = open(credPath.str().c_str(), O_RDONLY);
     if (fd >= 0) {
@@ -393,9 +826,9 @@ void ProcessCollector::collectCredentials(pid_t pid, MetadataResult& result) {
             result.addAttribute("sgid", static_cast<int64_t>(cred.pr_sgid));
 
             // Resolve effective username
-            struct passwd* pwd = getpwuid(cred.pr_euid);
-            if (pwd != nullptr) {
-                result.addAttribute("effective_user", std::string(pwd->pw_name));
+            std::string effectiveUser;
+            if (IdentityCache::instance().lookupUser(cred.pr_euid, effectiveUser)) {
+                result.addAttribute("effective_user", effectiveUser);
             }
         }
         close(fd);
@@ -404,7 +837,21 @@ void ProcessCollector::collectCredentials(pid_t pid, MetadataResult& result) {
 }
 
 std::string ProcessCollector::stateToString(unsigned char state) {
-#ifdef _AIX
+#if defined(__linux__)
+    // State letters of /proc/<pid>/stat
+    switch (state) {
+        case 'R': return "running";
+        case 'S': return "sleeping";
+        case 'D': return "disk_sleep";
+        case 'Z': return "zombie";
+        case 'T': return "stopped";
+        case 't': return "traced";
+        case 'X': return "dead";
+        case 'I': return "idle";
+        case 'P': return "parked";
+        default:  return "unknown";
+    }
+#elif defined(_AIX)
     // AIX process states from procinfo.h
     switch (state) {
         case SNONE:   return "none";
@@ -422,19 +869,10 @@ std::string ProcessCollector::stateToString(unsigned char state) {
 
 std::string ProcessCollector::timeToString(uint64_t timeVal) {
     // Convert time to ISO 8601 format
-    time_t t = static_cast<time_t>(timeVal);
-    struct tm* tm_info = localtime(&t);
-
-    if (tm_info == nullptr) {
-        return "unknown";
-    }
-
-    char buffer[32];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", tm_info);
-    return std::string(buffer);
+    return m_timestamps.format(static_cast<int64_t>(timeVal));
 }
 
-void ProcessCollector::collectWparInfo(pid_t pid, MetadataResult& result) {
+void ProcessCollector::collectWparInfo(const ProcessContext& ctx, MetadataResult& result) {
 #ifdef _AIX
     /**
      * WPAR (Workload Partition) Detection for AIX
@@ -455,23 +893,18 @@ void ProcessCollector::collectWparInfo(pid_t pid, MetadataResult& result) {
      *       because WPARs only see their own processes as "global" to them.
      */
 
-    struct procentry64 procInfo;
-    pid_t inputPid = pid;
-
-    int count = getprocs64(&procInfo, sizeof(procInfo), nullptr, 0, &inputPid, 1);
-
-    if (count == 1 && procInfo.pi_pid == pid) {
+    {
         // Get the Corral ID (WPAR ID) directly from the process structure
-        cid_t wparCid = procInfo.pi_cid;
+        cid_t wparCid = ctx.entry.pi_cid;
 
         result.addAttribute("wpar_cid", static_cast<int64_t>(wparCid));
 
         if (wparCid == 0) {
             // Process is in Global environment
-            result.addAttribute("is_container", "false");
+            result.addAttribute("is_container", false);
         } else {
             // Process is in a WPAR container
-            result.addAttribute("is_container", "true");
+            result.addAttribute("is_container", true);
 
             // Optionally, try to resolve WPAR name from /etc/corrals/index
             // Format: WparID:Type:Name:Kernel_CID
@@ -511,12 +944,11 @@ void ProcessCollector::collectWparInfo(pid_t pid, MetadataResult& result) {
             }
         }
     }
-    // If getprocs64 failed, we don't add WPAR info (process may not exist)
 
 #else
     // Non-AIX stub for development/testing
     result.addAttribute("wpar_cid", static_cast<int64_t>(0));
-    result.addAttribute("is_container", "false");
+    result.addAttribute("is_container", false);
     result.addAttribute("wpar_note", "WPAR detection requires AIX");
 #endif
 }
@@ -0,0 +1,475 @@
+/**
+ * @file query_server.cpp
+ * @brief Implementation of the Unix domain socket query server
+ */
+
+#include "query_server.h"
+#include "json_writer.h"
+
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <map>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace AixMetadata {
+
+namespace {
+
+// Longest request line accepted before the client is dropped
+const size_t MAX_REQUEST_LINE = 64 * 1024;
+
+volatile sig_atomic_t g_stopRequested = 0;
+
+void handleStopSignal(int /* sig */) {
+    g_stopRequested = 1;
+}
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+#ifndef __linux__
+/**
+ * @brief Keep a descriptor out of the netstat/lsof children CommandRunner starts
+ *
+ * Linux creates the sockets close-on-exec (SOCK_CLOEXEC, accept4()).
+ */
+bool setCloseOnExec(int fd) {
+    int flags = fcntl(fd, F_GETFD, 0);
+    return flags >= 0 && fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == 0;
+}
+#endif
+
+void skipWhitespace(const std::string& s, size_t& pos) {
+    while (pos < s.size() &&
+           (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r' || s[pos] == '\n')) {
+        pos++;
+    }
+}
+
+/**
+ * @brief Parse a JSON string literal starting at pos (which must be '"')
+ */
+bool parseJsonString(const std::string& s, size_t& pos, std::string& out) {
+    if (pos >= s.size() || s[pos] != '"') return false;
+    pos++;
+    out.clear();
+
+    while (pos < s.size()) {
+        char c = s[pos++];
+        if (c == '"') return true;
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= s.size()) return false;
+
+        char e = s[pos++];
+        switch (e) {
+            case '"':  out += '"';  break;
+            case '\\': out += '\\'; break;
+            case '/':  out += '/';  break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'n':  out += '\n'; break;
+            case 'r':  out += '\r'; break;
+            case 't':  out += '\t'; break;
+            case 'u': {
+                if (pos + 4 > s.size()) return false;
+                unsigned int cp = 0;
+                for (int i = 0; i < 4; i++) {
+                    char h = s[pos++];
+                    cp <<= 4;
+                    if (h >= '0' && h <= '9') cp |= h - '0';
+                    else if (h >= 'a' && h <= 'f') cp |= h - 'a' + 10;
+                    else if (h >= 'A' && h <= 'F') cp |= h - 'A' + 10;
+                    else return false;
+                }
+                // Encode as UTF-8 (surrogate pairs are not combined)
+                if (cp < 0x80) {
+                    out += static_cast<char>(cp);
+                } else if (cp < 0x800) {
+                    out += static_cast<char>(0xC0 | (cp >> 6));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                } else {
+                    out += static_cast<char>(0xE0 | (cp >> 12));
+                    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    out += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Parse a flat JSON object whose values are strings or integers
+ *
+ * Requests only ever carry a handful of scalar fields, so nested values
+ * are rejected rather than supported.
+ */
+bool parseFlatObject(const std::string& s, std::map<std::string, std::string>& fields) {
+    size_t pos = 0;
+    skipWhitespace(s, pos);
+    if (pos >= s.size() || s[pos] != '{') return false;
+    pos++;
+
+    skipWhitespace(s, pos);
+    if (pos < s.size() && s[pos] == '}') {
+        pos++;
+    } else {
+        for (;;) {
+            std::string key;
+            std::string value;
+
+            skipWhitespace(s, pos);
+            if (!parseJsonString(s, pos, key)) return false;
+            skipWhitespace(s, pos);
+            if (pos >= s.size() || s[pos] != ':') return false;
+            pos++;
+            skipWhitespace(s, pos);
+
+            if (pos < s.size() && s[pos] == '"') {
+                if (!parseJsonString(s, pos, value)) return false;
+            } else {
+                // Bare integer (e.g. "id":1234)
+                size_t start = pos;
+                if (pos < s.size() && s[pos] == '-') pos++;
+                while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') pos++;
+                if (pos == start) return false;
+                value = s.substr(start, pos - start);
+            }
+
+            fields[key] = value;
+
+            skipWhitespace(s, pos);
+            if (pos < s.size() && s[pos] == ',') {
+                pos++;
+                continue;
+            }
+            if (pos < s.size() && s[pos] == '}') {
+                pos++;
+                break;
+            }
+            return false;
+        }
+    }
+
+    skipWhitespace(s, pos);
+    return pos == s.size();
+}
+
+MetadataResult requestError(const std::string& identifier, const std::string& message) {
+    MetadataResult result;
+    result.success = false;
+    result.identifier = identifier;
+    result.errorMessage = message;
+    return result;
+}
+
+} // anonymous namespace
+
+QueryServer::QueryServer(const std::string& socketPath, CollectorSet& collectors,
+                         Protocol defaultProtocol)
+    : m_socketPath(socketPath),
+      m_collectors(collectors),
+      m_defaultProtocol(defaultProtocol),
+      m_stringValues(false),
+      m_listenFd(-1) {
+}
+
+QueryServer::~QueryServer() {
+    for (const auto& client : m_clients) {
+        close(client.fd);
+    }
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        unlink(m_socketPath.c_str());
+    }
+}
+
+bool QueryServer::start(std::string& errorMessage) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (m_socketPath.empty() || m_socketPath.size() >= sizeof(addr.sun_path)) {
+        errorMessage = "Invalid socket path: " + m_socketPath;
+        return false;
+    }
+    memcpy(addr.sun_path, m_socketPath.c_str(), m_socketPath.size() + 1);
+
+    // Remove a stale socket left by a previous run, but never a regular file
+    struct stat st;
+    if (lstat(m_socketPath.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            errorMessage = "Path exists and is not a socket: " + m_socketPath;
+            return false;
+        }
+        unlink(m_socketPath.c_str());
+    }
+
+#ifdef SOCK_CLOEXEC
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+#else
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && !setCloseOnExec(fd)) {
+        close(fd);
+        fd = -1;
+    }
+#endif
+    if (fd < 0) {
+        errorMessage = std::string("Cannot create socket: ") + errnoToString(errno);
+        return false;
+    }
+
+    // Results may expose privileged data; restrict the socket to our user.
+    // Binding under umask 077 creates it that way, so there is no window
+    // in which other users could connect before the chmod().
+    mode_t oldMask = umask(S_IRWXG | S_IRWXO);
+    int bound = bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    int bindErrno = errno;
+    umask(oldMask);
+    if (bound != 0) {
+        errorMessage = "Cannot bind " + m_socketPath + ": " + errnoToString(bindErrno);
+        close(fd);
+        return false;
+    }
+
+    if (chmod(m_socketPath.c_str(), S_IRUSR | S_IWUSR) != 0) {
+        errorMessage = "Cannot restrict permissions of " + m_socketPath + ": " +
+                       errnoToString(errno);
+        close(fd);
+        unlink(m_socketPath.c_str());
+        return false;
+    }
+
+    if (listen(fd, 64) != 0 || !setNonBlocking(fd)) {
+        errorMessage = std::string("Cannot listen on socket: ") + errnoToString(errno);
+        close(fd);
+        unlink(m_socketPath.c_str());
+        return false;
+    }
+
+    m_listenFd = fd;
+    return true;
+}
+
+int QueryServer::run() {
+    if (m_listenFd < 0) {
+        return 1;
+    }
+
+    // Clients may disconnect mid-response; report that as EPIPE instead
+    signal(SIGPIPE, SIG_IGN);
+
+    // No SA_RESTART so that poll() is interrupted by a stop request
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handleStopSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    std::vector<struct pollfd> fds;
+
+    while (!g_stopRequested) {
+        fds.clear();
+
+        struct pollfd listenPfd;
+        listenPfd.fd = m_listenFd;
+        listenPfd.events = POLLIN;
+        listenPfd.revents = 0;
+        fds.push_back(listenPfd);
+
+        for (const auto& client : m_clients) {
+            struct pollfd pfd;
+            pfd.fd = client.fd;
+            pfd.events = POLLIN;
+            if (!client.output.empty()) {
+                pfd.events |= POLLOUT;
+            }
+            pfd.revents = 0;
+            fds.push_back(pfd);
+        }
+
+        int ready = poll(&fds[0], fds.size(), -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+
+        // Service existing clients first; indices match fds[1..]
+        std::vector<Client> remaining;
+        remaining.reserve(m_clients.size());
+
+        for (size_t i = 0; i < m_clients.size(); i++) {
+            Client& client = m_clients[i];
+            short revents = fds[i + 1].revents;
+            bool keep = true;
+
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                keep = readClient(client);
+            }
+            if (keep && !client.output.empty()) {
+                keep = writeClient(client, false);
+            }
+
+            if (keep) {
+                remaining.push_back(std::move(client));
+            } else {
+                close(client.fd);
+            }
+        }
+
+        m_clients.swap(remaining);
+
+        if (fds[0].revents & POLLIN) {
+            acceptClients();
+        }
+    }
+
+    return 0;
+}
+
+void QueryServer::acceptClients() {
+    for (;;) {
+#ifdef __linux__
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+#else
+        int fd = accept(m_listenFd, nullptr, nullptr);
+#endif
+        if (fd < 0) {
+            // EAGAIN: no more pending connections
+            return;
+        }
+
+#ifdef __linux__
+        if (!setNonBlocking(fd)) {
+#else
+        if (!setCloseOnExec(fd) || !setNonBlocking(fd)) {
+#endif
+            close(fd);
+            continue;
+        }
+
+        Client client;
+        client.fd = fd;
+        m_clients.push_back(std::move(client));
+    }
+}
+
+bool QueryServer::readClient(Client& client) {
+    char buffer[16384];
+
+    for (;;) {
+        ssize_t n = read(client.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            client.input.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0) {
+            // Peer closed; answer what we have, then disconnect once flushed
+            if (!client.input.empty()) {
+                handleRequest(client.input, client.output);
+                client.input.clear();
+            }
+            writeClient(client, true);
+            return false;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+    }
+
+    size_t start = 0;
+    size_t nl;
+    while ((nl = client.input.find('\n', start)) != std::string::npos) {
+        std::string line = client.input.substr(start, nl - start);
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        if (!line.empty()) {
+            handleRequest(line, client.output);
+        }
+        start = nl + 1;
+    }
+    client.input.erase(0, start);
+
+    return client.input.size() <= MAX_REQUEST_LINE;
+}
+
+bool QueryServer::writeClient(Client& client, bool drain) {
+    while (!client.output.empty()) {
+        ssize_t n = write(client.fd, client.output.data(), client.output.size());
+        if (n > 0) {
+            client.output.erase(0, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!drain) return true;
+            // Wait briefly so a final response is not lost
+            struct pollfd pfd;
+            pfd.fd = client.fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, 1000) <= 0) return false;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+void QueryServer::handleRequest(const std::string& line, std::string& output) {
+    std::map<std::string, std::string> fields;
+    MetadataResult result;
+
+    if (!parseFlatObject(line, fields)) {
+        result = requestError("", "Malformed request: expected a flat JSON object");
+    } else {
+        QueryRequest request;
+        std::map<std::string, std::string>::const_iterator type = fields.find("type");
+        std::map<std::string, std::string>::const_iterator id = fields.find("id");
+        std::map<std::string, std::string>::const_iterator proto = fields.find("protocol");
+
+        Protocol protocol = m_defaultProtocol;
+        bool protocolValid = true;
+        if (proto != fields.end()) {
+            if (proto->second == "tcp") protocol = Protocol::TCP;
+            else if (proto->second == "udp") protocol = Protocol::UDP;
+            else if (proto->second != "both") protocolValid = false;
+        }
+
+        if (type == fields.end() || id == fields.end()) {
+            result = requestError(id != fields.end() ? id->second : "",
+                                  "Request must contain \"type\" and \"id\"");
+        } else if (!parseQueryType(type->second, request.type)) {
+            result = requestError(id->second, "Unknown query type: " + type->second);
+        } else if (!protocolValid) {
+            result = requestError(id->second, "Invalid protocol. Use: tcp, udp, or both");
+        } else {
+            request.identifier = id->second;
+            m_collectors.port().setProtocol(protocol);
+            result = m_collectors.collect(request);
+        }
+    }
+
+    JsonWriter(output, false, m_stringValues).writeResult(result);
+    output += '\n';
+}
+
+} // namespace AixMetadata
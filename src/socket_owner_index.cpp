@@ -0,0 +1,148 @@
+/**
+ * @file socket_owner_index.cpp
+ * @brief Implementation of the socket inode to owning process index
+ *
+ * Each /proc/<pid>/fd/<n> entry is a symlink whose target is
+ * "socket:[<inode>]" for sockets. We walk every process once, read each
+ * fd link, and record the first process seen for every socket inode.
+ * Process name and UID are only read for processes that hold sockets.
+ */
+
+#include "socket_owner_index.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace AixMetadata {
+
+namespace {
+
+/**
+ * @brief Parse a numeric /proc directory entry name
+ */
+bool parsePidName(const char* name, pid_t& pid) {
+    if (*name < '1' || *name > '9') return false;
+    char* endPtr = nullptr;
+    long value = std::strtol(name, &endPtr, 10);
+    if (*endPtr != '\0' || value <= 0) return false;
+    pid = static_cast<pid_t>(value);
+    return true;
+}
+
+/**
+ * @brief Parse the inode out of a "socket:[12345]" link target
+ */
+bool parseSocketLink(const char* target, size_t len, uint64_t& inode) {
+    static const char prefix[] = "socket:[";
+    const size_t prefixLen = sizeof(prefix) - 1;
+
+    if (len <= prefixLen + 1 || memcmp(target, prefix, prefixLen) != 0 ||
+        target[len - 1] != ']') {
+        return false;
+    }
+
+    inode = 0;
+    for (size_t i = prefixLen; i < len - 1; i++) {
+        if (target[i] < '0' || target[i] > '9') return false;
+        inode = inode * 10 + static_cast<uint64_t>(target[i] - '0');
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+bool SocketOwnerIndex::build() {
+    m_owners.clear();
+    m_built = false;
+
+#ifdef _AIX
+    // AIX /proc/<pid>/fd entries are not socket:[inode] symlinks
+    return false;
+#else
+    DIR* proc = opendir("/proc");
+    if (proc == nullptr) {
+        return false;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(proc)) != nullptr) {
+        pid_t pid;
+        if (parsePidName(entry->d_name, pid)) {
+            indexProcess(pid);
+        }
+    }
+
+    closedir(proc);
+    m_built = true;
+    return true;
+#endif
+}
+
+void SocketOwnerIndex::indexProcess(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", static_cast<int>(pid));
+
+    DIR* dir = opendir(path);
+    if (dir == nullptr) {
+        // Process exited or we lack permission
+        return;
+    }
+
+    SocketOwner owner;
+    bool ownerLoaded = false;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        char target[64];
+        ssize_t len = readlinkat(dirfd(dir), entry->d_name, target, sizeof(target));
+
+        uint64_t inode;
+        if (len <= 0 || !parseSocketLink(target, static_cast<size_t>(len), inode)) {
+            continue;
+        }
+
+        if (!ownerLoaded) {
+            ownerLoaded = true;
+            owner.pid = pid;
+
+            snprintf(path, sizeof(path), "/proc/%d/comm", static_cast<int>(pid));
+            int fd = open(path, O_RDONLY);
+            if (fd >= 0) {
+                char comm[64];
+                ssize_t n = read(fd, comm, sizeof(comm) - 1);
+                if (n > 0) {
+                    if (comm[n - 1] == '\n') n--;
+                    owner.processName.assign(comm, static_cast<size_t>(n));
+                }
+                close(fd);
+            }
+
+            snprintf(path, sizeof(path), "/proc/%d", static_cast<int>(pid));
+            struct stat st;
+            if (stat(path, &st) == 0) {
+                owner.uid = st.st_uid;
+            }
+        }
+
+        // Keep the first holder for sockets shared across processes
+        m_owners.insert(std::make_pair(inode, owner));
+    }
+
+    closedir(dir);
+}
+
+const SocketOwner* SocketOwnerIndex::find(uint64_t inode) const {
+    auto it = m_owners.find(inode);
+    return (it != m_owners.end()) ? &it->second : nullptr;
+}
+
+} // namespace AixMetadata
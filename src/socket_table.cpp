@@ -0,0 +1,634 @@
+/**
+ * @file socket_table.cpp
+ * @brief Implementation of native socket table readers
+ *
+ * /proc/net/tcp format (one socket per line, after a header line):
+ *   sl  local_address rem_address   st tx_queue:rx_queue tr:tm->when retrnsmt   uid  timeout inode ...
+ *    0: 0100007F:0CEA 00000000:0000 0A 00000000:00000000 00:00000000 00000000  1000        0 12345 ...
+ *
+ * Addresses are printed as the hex value of the raw 32-bit words in host
+ * byte order, followed by the port in hex. IPv6 tables use four such words.
+ *
+ * The netlink backend sends SOCK_DIAG_BY_FAMILY dump requests with an
+ * inet_diag bytecode program attached; the kernel runs it for every socket
+ * and only sends back the sockets it accepts. Every backend still checks
+ * each socket against the port bitmap, which is a single bit lookup.
+ */
+
+#include "socket_table.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#endif
+
+namespace AixMetadata {
+
+namespace {
+
+/**
+ * @brief Read an entire (proc) file into a buffer
+ *
+ * /proc files report a size of 0, so we read until EOF with large reads.
+ */
+bool readWholeFile(const char* path, std::string& output) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    output.clear();
+    size_t used = 0;
+    output.resize(65536);
+
+    for (;;) {
+        if (output.size() - used < 16384) {
+            output.resize(output.size() * 2);
+        }
+        ssize_t n = ::read(fd, &output[used], output.size() - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            return false;
+        }
+        if (n == 0) break;
+        used += static_cast<size_t>(n);
+    }
+
+    close(fd);
+    output.resize(used);
+    return true;
+}
+
+/**
+ * @brief Return the next blank-delimited field, advancing the cursor
+ */
+bool nextField(const char*& p, const char* end, const char*& field, size_t& len) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    if (p >= end) return false;
+    field = p;
+    while (p < end && *p != ' ' && *p != '\t') ++p;
+    len = static_cast<size_t>(p - field);
+    return true;
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/**
+ * @brief Parse exactly @p digits hex characters into a 32-bit value
+ */
+bool parseHex32(const char* s, size_t digits, uint32_t& value) {
+    value = 0;
+    for (size_t i = 0; i < digits; i++) {
+        int d = hexDigit(s[i]);
+        if (d < 0) return false;
+        value = (value << 4) | static_cast<uint32_t>(d);
+    }
+    return true;
+}
+
+/**
+ * @brief Parse a decimal field into a 64-bit value
+ */
+bool parseDec64(const char* s, size_t len, uint64_t& value) {
+    value = 0;
+    if (len == 0) return false;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        value = value * 10 + static_cast<uint64_t>(s[i] - '0');
+    }
+    return true;
+}
+
+/**
+ * @brief Split an "ADDRHEX:PORTHEX" field and decode the port
+ */
+bool parseEndpoint(const char* field, size_t len, size_t addrDigits,
+                   const char*& addrHex, uint16_t& port) {
+    if (len != addrDigits + 5 || field[addrDigits] != ':') {
+        return false;
+    }
+    uint32_t value;
+    if (!parseHex32(field + addrDigits + 1, 4, value)) {
+        return false;
+    }
+    addrHex = field;
+    port = static_cast<uint16_t>(value);
+    return true;
+}
+
+/**
+ * @brief Convert raw address words (in memory order) to text
+ *
+ * Uses "*" for the wildcard address. IPv4 uses only the first word.
+ */
+std::string formatAddressWords(const uint32_t* words, bool isIpv6) {
+    char text[INET6_ADDRSTRLEN];
+
+    if (isIpv6) {
+        if ((words[0] | words[1] | words[2] | words[3]) == 0) return "*";
+        struct in6_addr addr;
+        memcpy(addr.s6_addr, words, sizeof(addr.s6_addr));
+        if (inet_ntop(AF_INET6, &addr, text, sizeof(text)) == nullptr) return "?";
+    } else {
+        if (words[0] == 0) return "*";
+        struct in_addr addr;
+        memcpy(&addr.s_addr, &words[0], sizeof(addr.s_addr));
+        if (inet_ntop(AF_INET, &addr, text, sizeof(text)) == nullptr) return "?";
+    }
+
+    return std::string(text);
+}
+
+/**
+ * @brief Convert a /proc/net hex address to text
+ */
+std::string formatAddress(const char* addrHex, bool isIpv6) {
+    uint32_t words[4] = {0, 0, 0, 0};
+    int count = isIpv6 ? 4 : 1;
+
+    for (int i = 0; i < count; i++) {
+        if (!parseHex32(addrHex + i * 8, 8, words[i])) return "?";
+    }
+
+    return formatAddressWords(words, isIpv6);
+}
+
+std::string formatPort(uint16_t port) {
+    if (port == 0) return "*";
+    char text[8];
+    snprintf(text, sizeof(text), "%u", static_cast<unsigned>(port));
+    return std::string(text);
+}
+
+// Kernel TCP state numbers used for listening queries
+const uint32_t TCP_STATE_CLOSE = 0x07;
+const uint32_t TCP_STATE_LISTEN = 0x0A;
+
+/**
+ * @brief Check a socket against the requested ports
+ *
+ * Unconnected UDP sockets report the CLOSE state in the socket tables.
+ */
+bool matchesPorts(const PortSet& ports, bool listeningOnly, bool isTcp,
+                  uint32_t state, uint16_t localPort, uint16_t remotePort) {
+    if (listeningOnly) {
+        if (isTcp ? state != TCP_STATE_LISTEN : remotePort != 0) {
+            return false;
+        }
+        return ports.contains(localPort);
+    }
+    return ports.contains(localPort) || ports.contains(remotePort);
+}
+
+/**
+ * @brief Map a kernel TCP state number to the netstat state name
+ */
+const char* tcpStateName(uint32_t state) {
+    switch (state) {
+        case 0x01: return "ESTABLISHED";
+        case 0x02: return "SYN_SENT";
+        case 0x03: return "SYN_RCVD";
+        case 0x04: return "FIN_WAIT_1";
+        case 0x05: return "FIN_WAIT_2";
+        case 0x06: return "TIME_WAIT";
+        case 0x07: return "CLOSED";
+        case 0x08: return "CLOSE_WAIT";
+        case 0x09: return "LAST_ACK";
+        case 0x0A: return "LISTEN";
+        case 0x0B: return "CLOSING";
+        default:   return "UNKNOWN";
+    }
+}
+
+#ifdef __linux__
+
+// Receive buffer for sock_diag replies
+const size_t NETLINK_BUFFER_SIZE = 32768;
+
+// Largest number of range clauses put into a filter program; larger sets
+// are dumped unfiltered and matched in userspace (jump offsets are 16-bit)
+const size_t MAX_FILTER_CLAUSES = 1024;
+
+/**
+ * @brief SOCK_DIAG_BY_FAMILY dump request header; the filter program follows
+ */
+struct DiagRequest {
+    struct nlmsghdr header;
+    struct inet_diag_req_v2 request;
+    struct rtattr bytecodeAttr;
+};
+
+/**
+ * @brief Append one port comparison (the op plus its operand op)
+ */
+void appendPortCompare(std::vector<struct inet_diag_bc_op>& ops, unsigned char code,
+                       unsigned char yes, unsigned short no, uint16_t port) {
+    struct inet_diag_bc_op op;
+    op.code = code;
+    op.yes = yes;
+    op.no = no;
+    ops.push_back(op);
+    op.code = INET_DIAG_BC_NOP;
+    op.yes = 0;
+    op.no = port;
+    ops.push_back(op);
+}
+
+/**
+ * @brief Build a program accepting sockets whose ports fall in any range
+ *
+ * Each op jumps 'yes' or 'no' bytes ahead (JMP always takes 'no').
+ * Landing exactly on the end of the program accepts the socket, landing
+ * 4 bytes past it rejects it. The kernel only accepts 'no' targets that
+ * are reachable along the 'yes' chain, so the clauses of the OR are laid
+ * out one after another, each followed by a JMP to the end. Only the
+ * GE/LE comparisons are used since they exist on every kernel with
+ * sock_diag.
+ *
+ * One 20-byte step per range (the last one has no JMP):
+ *
+ *    o+0: S_GE lo   yes -> o+8    no -> o+20 (next clause, or reject)
+ *    o+8: S_LE hi   yes -> o+16   no -> o+20
+ *   o+16: JMP                     no -> end (accept)
+ *
+ * @param ranges Port ranges to match
+ * @param matchRemote Also emit D_GE/D_LE clauses for the remote port
+ * @param ops Output: the program
+ * @return false if the set has too many ranges for a program
+ */
+bool buildPortFilter(const std::vector<std::pair<uint16_t, uint16_t>>& ranges,
+                     bool matchRemote, std::vector<struct inet_diag_bc_op>& ops) {
+    const size_t clauses = ranges.size() * (matchRemote ? 2 : 1);
+    if (clauses == 0 || clauses > MAX_FILTER_CLAUSES) {
+        return false;
+    }
+
+    const size_t length = clauses * 20 - 4;
+    ops.clear();
+    ops.reserve(length / sizeof(struct inet_diag_bc_op));
+
+    for (size_t i = 0; i < clauses; ++i) {
+        const auto& range = ranges[i % ranges.size()];
+        const bool remote = i >= ranges.size();
+
+        appendPortCompare(ops, remote ? INET_DIAG_BC_D_GE : INET_DIAG_BC_S_GE,
+                          8, 20, range.first);
+        appendPortCompare(ops, remote ? INET_DIAG_BC_D_LE : INET_DIAG_BC_S_LE,
+                          8, 12, range.second);
+
+        if (i + 1 < clauses) {
+            struct inet_diag_bc_op jump;
+            jump.code = INET_DIAG_BC_JMP;
+            jump.yes = 4;
+            jump.no = static_cast<unsigned short>(length - (i * 20 + 16));
+            ops.push_back(jump);
+        }
+    }
+
+    return true;
+}
+
+#endif // __linux__
+
+} // anonymous namespace
+
+bool ProcNetSocketTableReader::read(const PortSet& ports, bool listeningOnly, Protocol proto,
+                                    std::vector<ConnectionInfo>& connections) {
+    bool anyRead = false;
+
+    if (proto == Protocol::TCP || proto == Protocol::Both) {
+        anyRead |= readTable("/proc/net/tcp", "tcp", true, false,
+                             ports, listeningOnly, connections);
+        anyRead |= readTable("/proc/net/tcp6", "tcp6", true, true,
+                             ports, listeningOnly, connections);
+    }
+
+    if (proto == Protocol::UDP || proto == Protocol::Both) {
+        anyRead |= readTable("/proc/net/udp", "udp", false, false,
+                             ports, listeningOnly, connections);
+        anyRead |= readTable("/proc/net/udp6", "udp6", false, true,
+                             ports, listeningOnly, connections);
+    }
+
+    return anyRead;
+}
+
+bool ProcNetSocketTableReader::readTable(const char* path, const char* protocol,
+                                         bool isTcp, bool isIpv6,
+                                         const PortSet& ports, bool listeningOnly,
+                                         std::vector<ConnectionInfo>& connections) {
+    std::string buffer;
+    if (!readWholeFile(path, buffer)) {
+        return false;
+    }
+
+    const size_t addrDigits = isIpv6 ? 32 : 8;
+    const char* p = buffer.data();
+    const char* end = p + buffer.size();
+
+    // Skip the header line
+    const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+    p = (nl != nullptr) ? nl + 1 : end;
+
+    while (p < end) {
+        nl = static_cast<const char*>(memchr(p, '\n', end - p));
+        const char* lineEnd = (nl != nullptr) ? nl : end;
+        const char* cur = p;
+        p = (nl != nullptr) ? nl + 1 : end;
+
+        const char* field;
+        size_t len;
+
+        // sl
+        if (!nextField(cur, lineEnd, field, len)) continue;
+
+        // local_address, rem_address
+        const char* localHex;
+        const char* remoteHex;
+        uint16_t localPort;
+        uint16_t remotePort;
+        if (!nextField(cur, lineEnd, field, len) ||
+            !parseEndpoint(field, len, addrDigits, localHex, localPort)) {
+            continue;
+        }
+        if (!nextField(cur, lineEnd, field, len) ||
+            !parseEndpoint(field, len, addrDigits, remoteHex, remotePort)) {
+            continue;
+        }
+
+        // Reject non-matching sockets before doing any conversions
+        if (!ports.contains(localPort) && !ports.contains(remotePort)) {
+            continue;
+        }
+
+        // st
+        uint32_t state = 0;
+        if (!nextField(cur, lineEnd, field, len) || len != 2 ||
+            !parseHex32(field, 2, state)) {
+            continue;
+        }
+
+        if (!matchesPorts(ports, listeningOnly, isTcp, state, localPort, remotePort)) {
+            continue;
+        }
+
+        // tx_queue:rx_queue, tr:tm->when, retrnsmt
+        if (!nextField(cur, lineEnd, field, len) ||
+            !nextField(cur, lineEnd, field, len) ||
+            !nextField(cur, lineEnd, field, len)) {
+            continue;
+        }
+
+        ConnectionInfo info;
+        info.protocol = protocol;
+        info.localAddress = formatAddress(localHex, isIpv6);
+        info.localPort = formatPort(localPort);
+        info.remoteAddress = formatAddress(remoteHex, isIpv6);
+        info.remotePort = formatPort(remotePort);
+
+        if (isTcp) {
+            info.state = tcpStateName(state);
+        } else if (remotePort != 0) {
+            // Connected UDP socket
+            info.state = "ESTABLISHED";
+        }
+
+        // uid, timeout, inode
+        uint64_t value;
+        if (nextField(cur, lineEnd, field, len) && parseDec64(field, len, value)) {
+            info.uid = static_cast<uid_t>(value);
+            if (nextField(cur, lineEnd, field, len) &&
+                nextField(cur, lineEnd, field, len) &&
+                parseDec64(field, len, value)) {
+                info.inode = value;
+            }
+        }
+
+        connections.push_back(info);
+    }
+
+    return true;
+}
+
+#ifdef __linux__
+
+bool NetlinkSocketTableReader::read(const PortSet& ports, bool listeningOnly, Protocol proto,
+                                    std::vector<ConnectionInfo>& connections) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool ok = true;
+
+    if (proto == Protocol::TCP || proto == Protocol::Both) {
+        ok = ok && dump(fd, AF_INET, IPPROTO_TCP, ports, listeningOnly, connections);
+        ok = ok && dump(fd, AF_INET6, IPPROTO_TCP, ports, listeningOnly, connections);
+    }
+
+    if (proto == Protocol::UDP || proto == Protocol::Both) {
+        ok = ok && dump(fd, AF_INET, IPPROTO_UDP, ports, listeningOnly, connections);
+        ok = ok && dump(fd, AF_INET6, IPPROTO_UDP, ports, listeningOnly, connections);
+    }
+
+    close(fd);
+    return ok;
+}
+
+bool NetlinkSocketTableReader::dump(int fd, int family, int ipProtocol,
+                                    const PortSet& ports, bool listeningOnly,
+                                    std::vector<ConnectionInfo>& connections) {
+    const uint32_t sequence = static_cast<uint32_t>(family << 8 | ipProtocol);
+    const bool isTcp = (ipProtocol == IPPROTO_TCP);
+
+    // Without a program (all ports, or too many ranges) the kernel
+    // returns every socket and the bitmap does the filtering
+    std::vector<struct inet_diag_bc_op> bytecode;
+    if (!ports.isAll()) {
+        buildPortFilter(ports.ranges(), !listeningOnly, bytecode);
+    }
+    const size_t bytecodeSize = bytecode.size() * sizeof(struct inet_diag_bc_op);
+    const size_t requestSize = bytecode.empty() ? offsetof(DiagRequest, bytecodeAttr)
+                                                : sizeof(DiagRequest) + bytecodeSize;
+
+    std::vector<char> message(requestSize, 0);
+    DiagRequest* req = reinterpret_cast<DiagRequest*>(&message[0]);
+    req->header.nlmsg_len = static_cast<uint32_t>(requestSize);
+    req->header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    req->header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req->header.nlmsg_seq = sequence;
+    req->request.sdiag_family = static_cast<uint8_t>(family);
+    req->request.sdiag_protocol = static_cast<uint8_t>(ipProtocol);
+    if (listeningOnly) {
+        req->request.idiag_states = 1u << (isTcp ? TCP_STATE_LISTEN : TCP_STATE_CLOSE);
+    } else {
+        req->request.idiag_states = static_cast<uint32_t>(-1);
+    }
+    if (!bytecode.empty()) {
+        req->bytecodeAttr.rta_type = INET_DIAG_REQ_BYTECODE;
+        req->bytecodeAttr.rta_len = static_cast<unsigned short>(RTA_LENGTH(bytecodeSize));
+        memcpy(&message[sizeof(DiagRequest)], &bytecode[0], bytecodeSize);
+    }
+
+    struct sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    ssize_t sent;
+    do {
+        sent = sendto(fd, &message[0], message.size(), 0,
+                      reinterpret_cast<struct sockaddr*>(&kernel), sizeof(kernel));
+    } while (sent < 0 && errno == EINTR);
+    if (sent != static_cast<ssize_t>(message.size())) {
+        return false;
+    }
+
+    const bool isIpv6 = (family == AF_INET6);
+    const char* protocol = isTcp ? (isIpv6 ? "tcp6" : "tcp") : (isIpv6 ? "udp6" : "udp");
+
+    std::vector<char> buffer(NETLINK_BUFFER_SIZE);
+
+    for (;;) {
+        ssize_t received = recv(fd, &buffer[0], buffer.size(), 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (received == 0) {
+            return false;
+        }
+
+        int remaining = static_cast<int>(received);
+        for (struct nlmsghdr* h = reinterpret_cast<struct nlmsghdr*>(&buffer[0]);
+             NLMSG_OK(h, remaining); h = NLMSG_NEXT(h, remaining)) {
+            if (h->nlmsg_seq != sequence) {
+                continue;
+            }
+            if (h->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+            if (h->nlmsg_type == NLMSG_ERROR) {
+                // e.g. ENOENT when the udp_diag module is not available
+                return false;
+            }
+            if (h->nlmsg_type != SOCK_DIAG_BY_FAMILY ||
+                h->nlmsg_len < NLMSG_LENGTH(sizeof(struct inet_diag_msg))) {
+                continue;
+            }
+
+            const struct inet_diag_msg* msg =
+                static_cast<const struct inet_diag_msg*>(NLMSG_DATA(h));
+            uint16_t localPort = ntohs(msg->id.idiag_sport);
+            uint16_t remotePort = ntohs(msg->id.idiag_dport);
+
+            if (!matchesPorts(ports, listeningOnly, isTcp, msg->idiag_state,
+                              localPort, remotePort)) {
+                continue;
+            }
+
+            ConnectionInfo info;
+            info.protocol = protocol;
+            info.localAddress = formatAddressWords(msg->id.idiag_src, isIpv6);
+            info.localPort = formatPort(localPort);
+            info.remoteAddress = formatAddressWords(msg->id.idiag_dst, isIpv6);
+            info.remotePort = formatPort(remotePort);
+
+            if (isTcp) {
+                info.state = tcpStateName(msg->idiag_state);
+            } else if (remotePort != 0) {
+                // Connected UDP socket
+                info.state = "ESTABLISHED";
+            }
+
+            info.uid = static_cast<uid_t>(msg->idiag_uid);
+            info.inode = msg->idiag_inode;
+
+            connections.push_back(info);
+        }
+    }
+}
+
+#else
+
+bool NetlinkSocketTableReader::read(const PortSet&, bool, Protocol,
+                                    std::vector<ConnectionInfo>&) {
+    // sock_diag is Linux-only
+    return false;
+}
+
+bool NetlinkSocketTableReader::dump(int, int, int, const PortSet&, bool,
+                                    std::vector<ConnectionInfo>&) {
+    return false;
+}
+
+#endif // __linux__
+
+void SocketTableReaderChain::add(std::unique_ptr<SocketTableReader> reader) {
+    m_readers.push_back(std::move(reader));
+}
+
+bool SocketTableReaderChain::read(const PortSet& ports, bool listeningOnly, Protocol proto,
+                                  std::vector<ConnectionInfo>& connections) {
+    for (auto& reader : m_readers) {
+        size_t before = connections.size();
+        if (reader->read(ports, listeningOnly, proto, connections)) {
+            return true;
+        }
+        // Drop partial results before trying the next backend
+        connections.erase(connections.begin() + before, connections.end());
+    }
+    return false;
+}
+
+std::string SocketTableReaderChain::getName() const {
+    std::string name;
+    for (const auto& reader : m_readers) {
+        if (!name.empty()) {
+            name += ",";
+        }
+        name += reader->getName();
+    }
+    return name;
+}
+
+std::unique_ptr<SocketTableReader> createNativeSocketTableReader() {
+#ifdef _AIX
+    // AIX has no /proc/net; netstat remains the default data source
+    return std::unique_ptr<SocketTableReader>();
+#else
+    std::unique_ptr<SocketTableReaderChain> chain(new SocketTableReaderChain());
+
+#ifdef __linux__
+    chain->add(std::unique_ptr<SocketTableReader>(new NetlinkSocketTableReader()));
+#endif
+    if (access("/proc/net/tcp", R_OK) == 0) {
+        chain->add(std::unique_ptr<SocketTableReader>(new ProcNetSocketTableReader()));
+    }
+
+    if (chain->empty()) {
+        return std::unique_ptr<SocketTableReader>();
+    }
+    return std::unique_ptr<SocketTableReader>(chain.release());
+#endif
+}
+
+} // namespace AixMetadata
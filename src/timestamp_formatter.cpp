@@ -0,0 +1,302 @@
+/**
+ * @file timestamp_formatter.cpp
+ * @brief Implementation of the ISO-8601 timestamp formatter
+ *
+ * Civil date conversions use the days-from-civil / civil-from-days
+ * algorithms on the proleptic Gregorian calendar, which are exact for
+ * every 64-bit day count and need no table or library call.
+ */
+
+#include "timestamp_formatter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <time.h>
+
+namespace AixMetadata {
+
+namespace {
+
+const int64_t SECONDS_PER_DAY = 86400;
+
+// Spacing of the probes that look for DST transitions around a time.
+// Zones do not change offset twice within this span.
+const int64_t PROBE_STEP = 7 * SECONDS_PER_DAY;
+
+// Furthest a window extends on either side of the time it was built for
+const int64_t MAX_WINDOW_SPAN = 366 * SECONDS_PER_DAY;
+
+// Windows kept before the cache is cleared
+const size_t MAX_WINDOWS = 256;
+
+// Zone rules are loaded by the first formatter constructed
+std::once_flag g_zoneLoaded;
+
+/**
+ * @brief Days since 1970-01-01 of a proleptic Gregorian date
+ */
+int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+    year -= (month <= 2) ? 1 : 0;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+/**
+ * @brief Proleptic Gregorian date of a day count since 1970-01-01
+ */
+void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    const unsigned yearOfEra =
+        (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+/**
+ * @brief Ask the C library for the UTC offset at a time
+ *
+ * The offset is the difference between the local broken-down time read
+ * as if it were UTC and the time itself.
+ */
+bool offsetAt(int64_t seconds, int32_t& offset) {
+    time_t t = static_cast<time_t>(seconds);
+    if (static_cast<int64_t>(t) != seconds) {
+        return false;
+    }
+
+    struct tm local;
+    if (localtime_r(&t, &local) == nullptr) {
+        return false;
+    }
+
+    int64_t asUtc = daysFromCivil(static_cast<int64_t>(local.tm_year) + 1900,
+                                  static_cast<unsigned>(local.tm_mon + 1),
+                                  static_cast<unsigned>(local.tm_mday)) * SECONDS_PER_DAY +
+                    local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    offset = static_cast<int32_t>(asUtc - seconds);
+    return true;
+}
+
+inline char* putDigits2(char* p, unsigned value) {
+    p[0] = static_cast<char>('0' + value / 10);
+    p[1] = static_cast<char>('0' + value % 10);
+    return p + 2;
+}
+
+} // anonymous namespace
+
+TimestampFormatter::TimestampFormatter(Precision precision, bool offsetSuffix)
+    : m_precision(precision),
+      m_offsetSuffix(offsetSuffix),
+      m_hits(0),
+      m_misses(0) {
+    // localtime_r() is not required to load the zone rules itself. Once
+    // per process: tzset() replaces the C library's zone state, which
+    // would race with formatters in use on other threads.
+    std::call_once(g_zoneLoaded, []() { tzset(); });
+}
+
+void TimestampFormatter::reset() {
+    tzset();
+    m_windows.clear();
+}
+
+size_t TimestampFormatter::format(int64_t seconds, uint32_t nanoseconds, char* out) {
+    int32_t offset;
+    if (!lookupOffset(seconds, offset)) {
+        return 0;
+    }
+
+    // Split local time into days and seconds of the day (floor division)
+    const int64_t local = seconds + offset;
+    int64_t days = local / SECONDS_PER_DAY;
+    int64_t secondOfDay = local % SECONDS_PER_DAY;
+    if (secondOfDay < 0) {
+        secondOfDay += SECONDS_PER_DAY;
+        days--;
+    }
+
+    int64_t year;
+    unsigned month;
+    unsigned day;
+    civilFromDays(days, year, month, day);
+
+    // Four-digit years only; strftime's %Y handles the rest
+    if (year < 0 || year > 9999) {
+        return 0;
+    }
+
+    const unsigned secs = static_cast<unsigned>(secondOfDay);
+    const unsigned y = static_cast<unsigned>(year);
+    char* p = out;
+
+    p = putDigits2(p, y / 100);
+    p = putDigits2(p, y % 100);
+    *p++ = '-';
+    p = putDigits2(p, month);
+    *p++ = '-';
+    p = putDigits2(p, day);
+    *p++ = 'T';
+    p = putDigits2(p, secs / 3600);
+    *p++ = ':';
+    p = putDigits2(p, secs / 60 % 60);
+    *p++ = ':';
+    p = putDigits2(p, secs % 60);
+
+    if (m_precision == Precision::Nanoseconds) {
+        *p++ = '.';
+        uint32_t fraction = nanoseconds % 1000000000u;
+        for (int i = 8; i >= 0; --i) {
+            p[i] = static_cast<char>('0' + fraction % 10);
+            fraction /= 10;
+        }
+        p += 9;
+    }
+
+    if (m_offsetSuffix) {
+        if (offset == 0) {
+            *p++ = 'Z';
+        } else {
+            unsigned magnitude = static_cast<unsigned>(offset < 0 ? -offset : offset);
+            *p++ = (offset < 0) ? '-' : '+';
+            p = putDigits2(p, magnitude / 3600);
+            *p++ = ':';
+            p = putDigits2(p, magnitude / 60 % 60);
+            // Historical offsets may include seconds
+            if (magnitude % 60 != 0) {
+                *p++ = ':';
+                p = putDigits2(p, magnitude % 60);
+            }
+        }
+    }
+
+    return static_cast<size_t>(p - out);
+}
+
+std::string TimestampFormatter::format(int64_t seconds, uint32_t nanoseconds) {
+    char buffer[MAX_LENGTH];
+    size_t length = format(seconds, nanoseconds, buffer);
+    if (length > 0) {
+        return std::string(buffer, length);
+    }
+
+    // Out of the fast path's range: let the C library try
+    time_t t = static_cast<time_t>(seconds);
+    struct tm local;
+    if (static_cast<int64_t>(t) != seconds || localtime_r(&t, &local) == nullptr ||
+        strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &local) == 0) {
+        return "unknown";
+    }
+    return std::string(buffer);
+}
+
+bool TimestampFormatter::lookupOffset(int64_t seconds, int32_t& offset) {
+    // Last window starting at or before 'seconds'
+    auto it = std::upper_bound(m_windows.begin(), m_windows.end(), seconds,
+                               [](int64_t value, const OffsetWindow& window) {
+                                   return value < window.start;
+                               });
+    if (it != m_windows.begin() && seconds < (it - 1)->end) {
+        m_hits++;
+        offset = (it - 1)->offset;
+        return true;
+    }
+
+    m_misses++;
+    OffsetWindow window;
+    if (!computeWindow(seconds, window)) {
+        return false;
+    }
+
+    if (m_windows.size() >= MAX_WINDOWS) {
+        m_windows.clear();
+        it = m_windows.end();
+    }
+
+    // The span limit may have cut a neighbouring window short; clip the
+    // new one against the windows just before and after 'seconds'
+    auto pos = it;
+    if (pos != m_windows.begin() && (pos - 1)->end > window.start) {
+        window.start = (pos - 1)->end;
+    }
+    if (pos != m_windows.end() && pos->start < window.end) {
+        window.end = pos->start;
+    }
+    m_windows.insert(pos, window);
+
+    offset = window.offset;
+    return true;
+}
+
+bool TimestampFormatter::computeWindow(int64_t seconds, OffsetWindow& window) {
+    int32_t offset;
+    if (!offsetAt(seconds, offset)) {
+        return false;
+    }
+
+    int32_t probeOffset;
+
+    // Forward: the first second with another offset ends the window
+    int64_t same = seconds;
+    int64_t end = seconds + MAX_WINDOW_SPAN;
+    while (same < end) {
+        int64_t next = std::min(same + PROBE_STEP, end);
+        if (offsetAt(next, probeOffset) && probeOffset == offset) {
+            same = next;
+            continue;
+        }
+
+        // Transition in (same, next]: bisect for its first second
+        int64_t changed = next;
+        while (changed - same > 1) {
+            int64_t mid = same + (changed - same) / 2;
+            if (offsetAt(mid, probeOffset) && probeOffset == offset) {
+                same = mid;
+            } else {
+                changed = mid;
+            }
+        }
+        end = changed;
+        break;
+    }
+
+    // Backward: the window starts right after the last differing second
+    same = seconds;
+    int64_t start = seconds - MAX_WINDOW_SPAN;
+    while (same > start) {
+        int64_t prev = std::max(same - PROBE_STEP, start);
+        if (offsetAt(prev, probeOffset) && probeOffset == offset) {
+            same = prev;
+            continue;
+        }
+
+        int64_t changed = prev;
+        while (same - changed > 1) {
+            int64_t mid = changed + (same - changed) / 2;
+            if (offsetAt(mid, probeOffset) && probeOffset == offset) {
+                same = mid;
+            } else {
+                changed = mid;
+            }
+        }
+        start = same;
+        break;
+    }
+
+    window.start = start;
+    window.end = end;
+    window.offset = offset;
+    return true;
+}
+
+} // namespace AixMetadata
@@ -4,20 +4,42 @@
  */
 
 #include "types.h"
-#include <sstream>
+
+#include <cstring>
 
 namespace AixMetadata {
 
-void MetadataResult::addAttribute(const std::string& name, int64_t value) {
-    std::ostringstream oss;
-    oss << value;
-    addAttribute(name, oss.str());
+namespace {
+
+// strerror_r() comes in two flavours: XSI (AIX, musl) returns an int and
+// fills the buffer; GNU returns the message, which may not be the buffer
+inline const char* strerrorResult(int rc, const char* buffer) {
+    return (rc == 0) ? buffer : "Unknown error";
+}
+
+inline const char* strerrorResult(const char* message, const char*) {
+    return message;
+}
+
+} // anonymous namespace
+
+bool parseQueryType(const std::string& name, QueryType& type) {
+    if (name == "process") {
+        type = QueryType::Process;
+    } else if (name == "file") {
+        type = QueryType::File;
+    } else if (name == "port") {
+        type = QueryType::Port;
+    } else {
+        return false;
+    }
+    return true;
 }
 
-void MetadataResult::addAttribute(const std::string& name, uint64_t value) {
-    std::ostringstream oss;
-    oss << value;
-    addAttribute(name, oss.str());
+std::string errnoToString(int err) {
+    char buffer[256];
+    buffer[0] = '\0';
+    return std::string(strerrorResult(strerror_r(err, buffer, sizeof(buffer)), buffer));
 }
 
 } // namespace AixMetadata
@@ -0,0 +1,229 @@
+/**
+ * @file bench_json_writer.cpp
+ * @brief Heap allocations and time per formatted result
+ *
+ * Formats a process-sized result (string attributes plus an open file
+ * list) many times and reports, per result, the heap allocations made
+ * and the time taken by:
+ *   - the 1.x ostringstream formatter, reproduced here as the baseline
+ *   - JsonFormatter::format(), which returns a new string per call
+ *   - JsonWriter appending into one reused buffer
+ *
+ * Allocations are counted by replacing the global operator new.
+ *
+ * Usage: bench_json_writer [iterations]
+ */
+
+#include "json_formatter.h"
+#include "json_writer.h"
+#include "types.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+unsigned long long g_allocations = 0;
+
+} // anonymous namespace
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = std::malloc(size != 0 ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+using namespace AixMetadata;
+
+namespace {
+
+/**
+ * @brief The 1.x formatter: nested ostringstreams, one per attribute and string
+ */
+class LegacyFormatter {
+public:
+    static std::string format(const MetadataResult& result, bool prettyPrint) {
+        std::ostringstream json;
+        std::string nl = prettyPrint ? "\n" : "";
+        std::string sp = prettyPrint ? " " : "";
+        int level = prettyPrint ? 1 : 0;
+
+        json << "{" << nl;
+        json << indent(level) << "\"success\":" << sp
+             << (result.success ? "true" : "false") << "," << nl;
+        json << indent(level) << "\"type\":" << sp << "\"" << escapeString(result.type)
+             << "\"," << nl;
+        json << indent(level) << "\"identifier\":" << sp << "\""
+             << escapeString(result.identifier) << "\"," << nl;
+        json << indent(level) << "\"attributes\":" << sp << "{" << nl;
+
+        bool firstAttr = true;
+        for (const auto& attr : result.attributes) {
+            if (!firstAttr) {
+                json << "," << nl;
+            }
+            firstAttr = false;
+            json << formatAttribute(attr, prettyPrint, 2);
+        }
+
+        json << nl << indent(level) << "}" << nl << "}";
+        return json.str();
+    }
+
+private:
+    static std::string escapeString(const std::string& str) {
+        std::ostringstream escaped;
+        for (char c : str) {
+            switch (c) {
+                case '"': escaped << "\\\""; break;
+                case '\\': escaped << "\\\\"; break;
+                case '\b': escaped << "\\b"; break;
+                case '\f': escaped << "\\f"; break;
+                case '\n': escaped << "\\n"; break;
+                case '\r': escaped << "\\r"; break;
+                case '\t': escaped << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        escaped << "\\u" << std::hex << std::setfill('0')
+                                << std::setw(4) << static_cast<int>(c);
+                    } else {
+                        escaped << c;
+                    }
+                    break;
+            }
+        }
+        return escaped.str();
+    }
+
+    static std::string indent(int level) {
+        return std::string(level * 2, ' ');
+    }
+
+    static std::string formatAttribute(const MetadataAttribute& attr, bool prettyPrint,
+                                       int indentLevel) {
+        std::ostringstream json;
+        std::string sp = prettyPrint ? " " : "";
+
+        json << indent(prettyPrint ? indentLevel : 0)
+             << "\"" << escapeString(attr.name) << "\":" << sp;
+
+        if (attr.values.size() == 1) {
+            json << "\"" << escapeString(attr.values[0]) << "\"";
+        } else if (attr.values.empty()) {
+            json << "null";
+        } else {
+            json << "[";
+            bool first = true;
+            for (const auto& value : attr.values) {
+                if (!first) {
+                    json << "," << sp;
+                }
+                first = false;
+                json << "\"" << escapeString(value) << "\"";
+            }
+            json << "]";
+        }
+        return json.str();
+    }
+};
+
+/**
+ * @brief A result shaped like a process query
+ */
+MetadataResult sampleResult() {
+    MetadataResult result;
+    result.success = true;
+    result.type = "process";
+    result.identifier = "4242";
+
+    const char* fields[][2] = {
+        { "pid", "4242" }, { "ppid", "1" }, { "pgid", "4242" }, { "sid", "4242" },
+        { "comm", "ds_agent" }, { "uid", "0" }, { "user", "root" }, { "gid", "0" },
+        { "group", "system" }, { "state", "active" }, { "priority", "60" },
+        { "nice", "20" }, { "cpu", "0" }, { "virtual_size_kb", "117648" },
+        { "resident_size_kb", "117776" }, { "start_time", "2025-12-09T15:18:40" },
+        { "num_threads", "15" }, { "flags", "0x40001" }, { "tty", "none" },
+        { "exe_path", "/opt/ds_agent/ds_agent" }, { "cwd", "/" },
+        { "cmdline", "/opt/ds_agent/ds_agent -b -i -w /var/opt/ds_agent -e \"ext\"" },
+        { "euid", "0" }, { "egid", "0" }, { "effective_user", "root" }
+    };
+    for (const auto& field : fields) {
+        result.addAttribute(field[0], field[1]);
+    }
+
+    std::vector<std::string> files;
+    for (int fd = 0; fd < 40; fd++) {
+        files.push_back(std::to_string(fd) + ":/var/opt/ds_agent/diag/trace." +
+                        std::to_string(fd) + ".log");
+    }
+    result.addAttribute("open_files", files);
+    return result;
+}
+
+/**
+ * @brief Print allocations and time per result for one formatter
+ */
+template <typename Format>
+void run(const char* label, int iterations, Format format) {
+    size_t bytes = 0;
+    unsigned long long before = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        bytes += format();
+    }
+    double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count();
+    printf("  %-34s %8.2f allocs/result %9.0f ns/result  (%zu bytes)\n", label,
+           static_cast<double>(g_allocations - before) / iterations, ns / iterations,
+           bytes / iterations);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    const MetadataResult result = sampleResult();
+    printf("%zu attributes, %d iterations\n", result.attributes.size(), iterations);
+
+    for (int pretty = 1; pretty >= 0; pretty--) {
+        printf("%s:\n", pretty ? "Pretty" : "Compact");
+
+        run("1.x ostringstream formatter", iterations, [&]() {
+            return LegacyFormatter::format(result, pretty != 0).size();
+        });
+
+        run("JsonFormatter::format (new string)", iterations, [&]() {
+            return JsonFormatter::format(result, pretty != 0, true).size();
+        });
+
+        std::string buffer;
+        run("JsonWriter (reused buffer)", iterations, [&]() {
+            buffer.clear();
+            JsonWriter(buffer, pretty != 0, true).writeResult(result);
+            return buffer.size();
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file bench_netstat_parse.cpp
+ * @brief netstat parsing cost on a large synthetic capture
+ *
+ * Builds an AIX "netstat -Aan" style capture (1M lines by default: mostly
+ * established TCP connections, some listeners, UDP sockets and the
+ * section headers netstat prints) and times parsing it for one port:
+ *   - the 1.x parser, reproduced here as the baseline: an istringstream
+ *     per capture and per line, every field copied into a std::string
+ *   - PortCollector::parseNetstatOutput(), which scans the buffer in place
+ *
+ * The queried port appears on about one line in a thousand, as on a busy
+ * server where the port of interest is one of many. The 1.x parser misses
+ * the UDP lines (they have no state column), so it reports fewer matches.
+ *
+ * Usage: bench_netstat_parse [lines] [iterations]
+ */
+
+#include "port_collector.h"
+#include "port_set.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace AixMetadata;
+
+namespace {
+
+const uint16_t QUERY_PORT = 8443;
+
+/**
+ * @brief The 1.x single-port parser
+ */
+void legacyParse(const std::string& output, uint16_t port, const std::string& protocol,
+                 std::vector<ConnectionInfo>& connections) {
+    std::istringstream stream(output);
+    std::string line;
+
+    while (std::getline(stream, line)) {
+        if (line.empty()) continue;
+
+        std::vector<std::string> tokens;
+        std::istringstream lineStream(line);
+        std::string token;
+        while (lineStream >> token) {
+            tokens.push_back(token);
+        }
+        if (tokens.size() < 6) continue;
+
+        size_t offset = 0;
+        if (tokens[0].length() > 10 &&
+            tokens[0].find_first_not_of("0123456789abcdefABCDEF") == std::string::npos) {
+            offset = 1;
+        }
+        if (tokens.size() < offset + 6) continue;
+
+        std::string localAddr = tokens[offset + 3];
+        std::string foreignAddr = tokens[offset + 4];
+        std::string state = tokens[offset + 5];
+
+        size_t lastDot = localAddr.rfind('.');
+        if (lastDot == std::string::npos) continue;
+
+        std::string localPortStr = localAddr.substr(lastDot + 1);
+        std::string localIp = localAddr.substr(0, lastDot);
+
+        char* endPtr;
+        long localPortNum = std::strtol(localPortStr.c_str(), &endPtr, 10);
+        if (*endPtr != '\0' || localPortNum != port) {
+            size_t foreignLastDot = foreignAddr.rfind('.');
+            if (foreignLastDot == std::string::npos) continue;
+            std::string foreignPortStr = foreignAddr.substr(foreignLastDot + 1);
+            long foreignPortNum = std::strtol(foreignPortStr.c_str(), &endPtr, 10);
+            if (*endPtr != '\0' || foreignPortNum != port) continue;
+        }
+
+        ConnectionInfo info;
+        info.protocol = protocol;
+        info.localAddress = localIp;
+        info.localPort = localPortStr;
+        info.state = state;
+
+        size_t foreignLastDot = foreignAddr.rfind('.');
+        if (foreignLastDot != std::string::npos) {
+            info.remoteAddress = foreignAddr.substr(0, foreignLastDot);
+            info.remotePort = foreignAddr.substr(foreignLastDot + 1);
+        } else {
+            info.remoteAddress = foreignAddr;
+            info.remotePort = "*";
+        }
+        connections.push_back(info);
+    }
+}
+
+/**
+ * @brief Generate a netstat -Aan capture of about 'lines' lines
+ */
+std::string makeCapture(size_t lines) {
+    std::string capture;
+    capture.reserve(lines * 96);
+    char line[160];
+
+    for (size_t i = 0; i < lines; i++) {
+        if (i % 50000 == 0) {
+            capture += "Active Internet connections (including servers)\n"
+                       "PCB/ADDR         Proto Recv-Q Send-Q  Local Address      "
+                       "Foreign Address    (state)\n";
+            continue;
+        }
+
+        unsigned long long pcb = 0xf1000e0001800000ULL + i * 0x400;
+        unsigned peer = static_cast<unsigned>(i * 2654435761u);
+        unsigned client = 1024 + static_cast<unsigned>(i % 60000);
+        uint16_t serverPort = (i % 1000 == 0) ? QUERY_PORT
+                            : static_cast<uint16_t>(9000 + i % 500);
+
+        if (i % 97 == 0) {
+            snprintf(line, sizeof(line),
+                     "%llx udp4       0      0  *.%u              *.*\n",
+                     pcb, static_cast<unsigned>(serverPort));
+        } else if (i % 41 == 0) {
+            snprintf(line, sizeof(line),
+                     "%llx tcp4       0      0  *.%u              *.*                LISTEN\n",
+                     pcb, static_cast<unsigned>(serverPort));
+        } else {
+            snprintf(line, sizeof(line),
+                     "%llx tcp4       0      0  10.1.%u.%u.%u   172.16.%u.%u.%u  ESTABLISHED\n",
+                     pcb, static_cast<unsigned>((i >> 8) & 0xff),
+                     static_cast<unsigned>(i & 0xff), static_cast<unsigned>(serverPort),
+                     (peer >> 8) & 0xff, peer & 0xff, client);
+        }
+        capture += line;
+    }
+    return capture;
+}
+
+/**
+ * @brief Time repeated parses and print the mean
+ */
+template <typename Parse>
+void run(const char* label, size_t lines, int iterations, Parse parse) {
+    std::vector<ConnectionInfo> connections;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        connections.clear();
+        parse(connections);
+    }
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count() / iterations;
+    printf("  %-30s %9.1f ms/capture %7.1f ns/line  (%zu matches)\n",
+           label, ms, ms * 1e6 / lines, connections.size());
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    long lines = argc > 1 ? atol(argv[1]) : 1000000;
+    int iterations = argc > 2 ? atoi(argv[2]) : 3;
+    if (lines <= 0 || iterations <= 0) {
+        fprintf(stderr, "Usage: %s [lines] [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    const std::string capture = makeCapture(static_cast<size_t>(lines));
+    printf("%ld lines (%.1f MB), port %u, %d iterations\n", lines,
+           capture.size() / 1048576.0, static_cast<unsigned>(QUERY_PORT), iterations);
+
+    run("1.x istringstream parser", static_cast<size_t>(lines), iterations,
+        [&](std::vector<ConnectionInfo>& connections) {
+            legacyParse(capture, QUERY_PORT, "tcp", connections);
+        });
+
+    PortSet ports;
+    ports.add(QUERY_PORT);
+    run("in-place scan (tcp + udp)", static_cast<size_t>(lines), iterations,
+        [&](std::vector<ConnectionInfo>& connections) {
+            PortCollector::parseNetstatOutput(capture, ports, false, "tcp", connections);
+            PortCollector::parseNetstatOutput(capture, ports, false, "udp", connections);
+        });
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file bench_socket_table.cpp
+ * @brief Port query cost: native socket table readers vs the netstat path
+ *
+ * Opens a set of loopback listeners and connections so the socket tables
+ * are not trivially small, then times PortCollector::collect() for one of
+ * the listening ports with each backend:
+ *   - the platform's native reader chain (netlink, then /proc/net)
+ *   - each native reader on its own
+ *   - no reader, i.e. netstat plus lsof as on AIX
+ *
+ * The netstat path parses AIX output ("addr.port"); on Linux it finds no
+ * connections, so there it measures only the cost of the child processes.
+ *
+ * Usage: bench_socket_table [iterations] [connections]
+ */
+
+#include "port_collector.h"
+#include "socket_table.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using namespace AixMetadata;
+
+namespace {
+
+/**
+ * @brief Open a loopback listener on an ephemeral port
+ * @return Listening socket, or -1
+ */
+int listenLoopback(uint16_t& port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(fd, 1024) != 0 ||
+        getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len) != 0) {
+        close(fd);
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/**
+ * @brief Connect to a loopback port
+ * @return Connected socket, or -1
+ */
+int connectLoopback(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr = sockaddr_in();
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Time repeated queries of one port and print the mean
+ */
+void run(const char* label, PortCollector& collector, const std::string& port,
+         int iterations) {
+    size_t connections = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        MetadataResult result = collector.collect(port);
+        connections = 0;
+        for (const MetadataAttribute& attr : result.attributes) {
+            if (attr.name == "connections") {
+                connections = attr.children.size();
+            }
+        }
+    }
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    printf("  %-22s %9.3f ms/query  (%zu connections found)\n",
+           label, ms / iterations, connections);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 20;
+    int connectionCount = argc > 2 ? atoi(argv[2]) : 200;
+    if (iterations <= 0 || connectionCount < 0) {
+        fprintf(stderr, "Usage: %s [iterations] [connections]\n", argv[0]);
+        return 1;
+    }
+
+    uint16_t port = 0;
+    int listener = listenLoopback(port);
+    if (listener < 0) {
+        perror("listen");
+        return 1;
+    }
+
+    // Connections to the queried port, plus as many unrelated sockets
+    std::vector<int> fds;
+    for (int i = 0; i < connectionCount; i++) {
+        int client = connectLoopback(port);
+        if (client < 0) {
+            break;
+        }
+        fds.push_back(client);
+        fds.push_back(accept(listener, nullptr, nullptr));
+
+        uint16_t otherPort;
+        int other = listenLoopback(otherPort);
+        if (other >= 0) {
+            fds.push_back(other);
+        }
+    }
+
+    const std::string query = std::to_string(static_cast<unsigned>(port));
+    printf("Port %s, %zu sockets open, %d iterations\n", query.c_str(), fds.size() + 1,
+           iterations);
+
+    PortCollector native(Protocol::TCP);
+    run("native (default)", native, query, iterations);
+
+#ifdef __linux__
+    PortCollector netlink(Protocol::TCP);
+    netlink.setSocketTableReader(
+        std::unique_ptr<SocketTableReader>(new NetlinkSocketTableReader()));
+    run("netlink", netlink, query, iterations);
+#endif
+
+    PortCollector procNet(Protocol::TCP);
+    procNet.setSocketTableReader(
+        std::unique_ptr<SocketTableReader>(new ProcNetSocketTableReader()));
+    run("/proc/net", procNet, query, iterations);
+
+    PortCollector netstat(Protocol::TCP);
+    netstat.setSocketTableReader(std::unique_ptr<SocketTableReader>());
+    run("netstat + lsof", netstat, query, iterations);
+
+    for (int fd : fds) {
+        close(fd);
+    }
+    close(listener);
+    return 0;
+}
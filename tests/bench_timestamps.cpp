@@ -0,0 +1,143 @@
+/**
+ * @file bench_timestamps.cpp
+ * @brief Timestamp rendering cost: TimestampFormatter vs localtime_r()
+ *
+ * Renders 1M timestamps (by default) in two distributions:
+ *   - spread: uniformly over the last ten years, the worst case for the
+ *     offset cache (many DST windows)
+ *   - recent: within the last day, as for the files of a busy directory
+ * with
+ *   - the 1.x path: localtime_r() + strftime() into a new std::string
+ *   - TimestampFormatter::format() returning a std::string
+ *   - TimestampFormatter::format() into a caller's buffer
+ *
+ * Every formatter output is also compared with strftime()'s; a mismatch
+ * fails the run. Set TZ to measure a zone with DST; `make bench` uses the
+ * POSIX rule TZ=CET-1CEST,M3.5.0,M10.5.0/3, which needs no zone files.
+ *
+ * Usage: bench_timestamps [count]
+ */
+
+#include "timestamp_formatter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <time.h>
+
+using namespace AixMetadata;
+
+namespace {
+
+/**
+ * @brief The 1.x conversion
+ */
+std::string legacyFormat(time_t value) {
+    struct tm tm_info;
+    if (localtime_r(&value, &tm_info) == nullptr) {
+        return "unknown";
+    }
+    char buffer[32];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm_info);
+    return std::string(buffer);
+}
+
+/**
+ * @brief Time one rendering of every timestamp and print the mean
+ */
+template <typename Render>
+void run(const char* label, const std::vector<int64_t>& times, Render render) {
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t t : times) {
+        bytes += render(t);
+    }
+    double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count();
+    printf("  %-28s %8.1f ns/timestamp  (%zu bytes)\n", label, ns / times.size(), bytes);
+}
+
+/**
+ * @brief Compare the formatter with strftime() for every timestamp
+ * @return Number of mismatches
+ */
+size_t verify(const std::vector<int64_t>& times) {
+    TimestampFormatter formatter;
+    size_t mismatches = 0;
+    for (int64_t t : times) {
+        std::string expected = legacyFormat(static_cast<time_t>(t));
+        std::string actual = formatter.format(t);
+        if (actual != expected) {
+            if (mismatches == 0) {
+                fprintf(stderr, "FAIL: %lld rendered as %s, strftime gives %s\n",
+                        static_cast<long long>(t), actual.c_str(), expected.c_str());
+            }
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * @brief Benchmark one distribution of timestamps
+ * @return Number of mismatches against strftime()
+ */
+size_t bench(const char* name, const std::vector<int64_t>& times) {
+    printf("%s:\n", name);
+
+    run("localtime_r + strftime", times, [](int64_t t) {
+        return legacyFormat(static_cast<time_t>(t)).size();
+    });
+
+    TimestampFormatter strings;
+    run("TimestampFormatter (string)", times, [&](int64_t t) {
+        return strings.format(t).size();
+    });
+
+    TimestampFormatter buffered;
+    char buffer[TimestampFormatter::MAX_LENGTH];
+    run("TimestampFormatter (buffer)", times, [&](int64_t t) {
+        return buffered.format(t, 0, buffer);
+    });
+    printf("  offset cache: %llu hits, %llu misses\n",
+           static_cast<unsigned long long>(buffered.getCacheHits()),
+           static_cast<unsigned long long>(buffered.getCacheMisses()));
+
+    return verify(times);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    long count = argc > 1 ? atol(argv[1]) : 1000000;
+    if (count <= 0) {
+        fprintf(stderr, "Usage: %s [count]\n", argv[0]);
+        return 1;
+    }
+
+    const char* zone = getenv("TZ");
+    printf("%ld timestamps, TZ=%s\n", count, zone != nullptr ? zone : "(unset)");
+
+    const int64_t now = static_cast<int64_t>(time(nullptr));
+    const int64_t tenYears = 10 * 365 * 86400LL;
+    std::mt19937_64 rng(1);
+
+    std::vector<int64_t> spread(static_cast<size_t>(count));
+    std::vector<int64_t> recent(static_cast<size_t>(count));
+    for (long i = 0; i < count; i++) {
+        spread[i] = now - static_cast<int64_t>(rng() % tenYears);
+        recent[i] = now - static_cast<int64_t>(rng() % 86400);
+    }
+
+    size_t mismatches = bench("Spread over ten years", spread);
+    mismatches += bench("Within the last day", recent);
+
+    if (mismatches != 0) {
+        fprintf(stderr, "FAIL: %zu timestamps differ from strftime\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
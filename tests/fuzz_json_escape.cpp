@@ -0,0 +1,155 @@
+/**
+ * @file fuzz_json_escape.cpp
+ * @brief Differential fuzzer for the JSON escape scanners
+ *
+ * Generates random buffers and checks that every scanner available on
+ * this CPU (AVX2, SSE2, SWAR) returns the same offset as the byte-at-a-
+ * time scalar scan, and that JsonWriter::appendEscaped() produces the same
+ * text as a straightforward reference escaper. Inputs vary in length
+ * (across the 8/16/32-byte step boundaries), start alignment and byte mix:
+ * mostly clean text with occasional quotes, backslashes, control bytes
+ * and bytes >= 0x80, which must not be mistaken for control characters.
+ *
+ * Usage: fuzz_json_escape [iterations] [seed]
+ * Exits non-zero after printing the first mismatching input.
+ */
+
+#include "json_escape.h"
+#include "json_writer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace AixMetadata;
+
+namespace {
+
+const char* const BACKENDS[] = { "swar", "sse2", "avx2" };
+
+/**
+ * @brief Reference escaper, one byte at a time
+ */
+std::string referenceEscape(const std::string& str) {
+    static const char HEX[] = "0123456789abcdef";
+    std::string out;
+    for (char ch : str) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += HEX[c >> 4];
+                    out += HEX[c & 0x0f];
+                } else {
+                    out += ch;
+                }
+                break;
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Random byte, biased towards clean printable text
+ */
+char randomByte(std::mt19937& rng, unsigned escapeOdds) {
+    unsigned roll = rng() % 1000;
+    if (roll < escapeOdds) {
+        static const char SPECIAL[] = { '"', '\\', '\n', '\t', '\0', '\x01', '\x1f' };
+        return SPECIAL[rng() % sizeof(SPECIAL)];
+    }
+    if (roll < escapeOdds + 50) {
+        // High bytes: 0x80-0xff, negative as signed char
+        return static_cast<char>(0x80 + rng() % 0x80);
+    }
+    if (roll < escapeOdds + 60) {
+        // Bytes next to the control and quote ranges
+        static const char EDGE[] = { ' ', '!', '#', '[', ']', '\x7f' };
+        return EDGE[rng() % sizeof(EDGE)];
+    }
+    return static_cast<char>('a' + rng() % 26);
+}
+
+void printInput(const char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        fprintf(stderr, "%02x", static_cast<unsigned char>(data[i]));
+    }
+    fprintf(stderr, "\n");
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    unsigned long seed = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1;
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<const char*> backends;
+    size_t unused;
+    for (const char* name : BACKENDS) {
+        if (findJsonEscapeWith(name, "", 0, unused)) {
+            backends.push_back(name);
+        }
+    }
+    printf("Selected scanner: %s; checking", jsonEscapeBackend());
+    for (const char* name : backends) {
+        printf(" %s", name);
+    }
+    printf(" against scalar, %ld iterations, seed %lu\n", iterations, seed);
+
+    std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+    std::vector<char> buffer(512 + 64);
+    std::string escaped;
+
+    for (long i = 0; i < iterations; i++) {
+        // Mostly short inputs around the vector widths, some long ones
+        size_t size = rng() % 4 == 0 ? rng() % 512 : rng() % 80;
+        size_t align = rng() % 64;
+        unsigned escapeOdds = rng() % 3 == 0 ? 0 : 1 + rng() % 40;
+
+        char* data = &buffer[align];
+        for (size_t j = 0; j < size; j++) {
+            data[j] = randomByte(rng, escapeOdds);
+        }
+
+        size_t expected;
+        findJsonEscapeWith("scalar", data, size, expected);
+        for (const char* name : backends) {
+            size_t offset;
+            findJsonEscapeWith(name, data, size, offset);
+            if (offset != expected) {
+                fprintf(stderr, "FAIL: %s returned %zu, scalar %zu (iteration %ld, "
+                        "size %zu, alignment %zu), input:\n", name, offset, expected, i,
+                        size, align);
+                printInput(data, size);
+                return 1;
+            }
+        }
+
+        const std::string input(data, size);
+        escaped.clear();
+        JsonWriter::appendEscaped(escaped, input);
+        if (escaped != referenceEscape(input)) {
+            fprintf(stderr, "FAIL: appendEscaped differs from the reference (iteration %ld, "
+                    "size %zu), input:\n", i, size);
+            printInput(data, size);
+            return 1;
+        }
+    }
+
+    printf("PASS: no mismatches\n");
+    return 0;
+}